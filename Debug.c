@@ -53,6 +53,45 @@
   CJB: 07-Jun-26: Guard against log file name buffer overflow.
   CJB: 08-Jun-26: Avoid mixed-signedness comparison in log file name
                   buffer overflow check.
+  CJB: 16-Oct-26: Added DebugOutput_RingBuffer mode. Split the opening,
+                  closing and writing of each output into separate functions
+                  so that text held in ring buffers can be written to any
+                  of the other outputs.
+                  Log files can be written asynchronously by a background
+                  thread. debug_printfl outputs its line feed as part of
+                  the same operation as the rest of the line.
+                  Added DebugOutput_Binary mode.
+                  The levels of debugging output for each category can be
+                  configured by an environment variable.
+                  Added DebugOutput_MappedFile mode.
+                  All debugging output is copied to the flight recorder.
+                  Repeated lines and lines from call sites that exceed a
+                  rate limit can be suppressed.
+                  DebugOutput_FlushedFile no longer flushes the log file
+                  after every call; instead, lines are committed in groups.
+                  Lines output to Reporter or SysLog are assembled in a
+                  growable buffer for each thread instead of a shared static
+                  buffer of fixed size. Added DebugOutput_LineSink mode.
+                  Added debug_log_kv to output structured records.
+                  Lines can be prefixed with timestamps and thread IDs.
+                  DebugOutput_File mode can rotate the log file by size.
+                  Added DebugOutput_Socket mode.
+                  Common conversions are formatted without using the C
+                  library's printf functions.
+                  Output can be sent to several sinks at once, each with its
+                  own filter, after being formatted only once.
+                  Log files are created in a configurable directory. Lines
+                  are written directly to the log file's descriptor, where
+                  supported.
+                  Added DebugOutput_Trace mode.
+                  The category of each line is recorded in binary logs.
+                  Text is formatted once for the flight recorder and the
+                  output mode.
+                  Only complete lines output in DebugOutput_FlushedFile mode
+                  are written directly to the log file's descriptor.
+                  Structured records are output in the caller's category,
+                  with the same prefix as other lines.
+                  A pending count of repeated lines is output on abort.
 */
 
 /* ISO library headers */
@@ -71,6 +110,7 @@
 /* Local headers */
 #include "Debug.h"
 #include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
 
 #define Report_Text0      0x054C80 /* SWI number for the Reporter module */
 
@@ -87,48 +127,153 @@
 
 #define SYSLOG_PRIORITY 124
 
-#define TRUNC_STRING "..."
-#define BAD_STRING "BAD"
+#ifdef ACORN_C
+#define LEVELS_VAR "CBDebug$Levels"
+#define LOG_DIR_VAR "CBDebug$LogDir"
+#else
+#define LEVELS_VAR "CBDEBUG_LEVELS"
+#define LOG_DIR_VAR "CBDEBUG_LOG_DIR"
+#endif
+
+#if defined(ACORN_C) || defined(__riscos)
+#define LOG_DIR_DEFAULT "<Wimp$ScrapDir>"
+#define DIR_SEPARATOR "."
+#else
+#define LOG_DIR_DEFAULT "/tmp"
+#define DIR_SEPARATOR "/"
+#endif
+
+enum
+{
+  MaxSinks = 8
+};
+
+typedef struct
+{
+  DebugOutput   output_mode;
+  unsigned long categories; /* bit n represents category n */
+  DebugLevel    level;      /* most verbose level to output */
+}
+DebugSink;
 
 static DebugOutput mode = DebugOutput_None;
+static DebugOutput open_mode = DebugOutput_None;
+static char log_name_copy[256];
+static char log_dir[256]; /* empty to use the default directory */
 static _Optional FILE *log_file;
+static DebugSink sinks[MaxSinks];
+static size_t nsinks;
 #ifdef ACORN_C
 static int syslog_handle;
 #endif
 
-#ifdef DEBUG_OUTPUT
 /* ----------------------------------------------------------------------- */
 /*                         Private functions                               */
 
-static void _debug_at_exit(void)
+static DebugOutput resource_key(DebugOutput output_mode)
 {
-  /* Called at exit to ensure that any open session log or file is closed */
-  debug_set_output(DebugOutput_None, "");
+  /* Which outputs share the same resources (e.g. an open file)? */
+  switch (output_mode)
+  {
+    case DebugOutput_FlushedFile:
+    case DebugOutput_File:
+      return DebugOutput_File;
+
+    case DebugOutput_Binary:
+    case DebugOutput_MappedFile:
+    case DebugOutput_Socket:
+    case DebugOutput_Trace:
+      return output_mode;
+
+#ifdef ACORN_C
+    case DebugOutput_SysLog:
+    case DebugOutput_SessionLog:
+      return output_mode;
+#endif
+
+    default:
+      return DebugOutput_None;
+  }
 }
 
 /* ----------------------------------------------------------------------- */
-/*                         Public functions                                */
 
-DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
+static bool conflicts(DebugOutput a, DebugOutput b)
 {
-  assert(output_mode < DebugOutput_LAST);
-  assert(log_name != NULL);
+  /* Can't two outputs be used at the same time (e.g. because they would
+     both use the same file handle)? */
+  DebugOutput ka = resource_key(a), kb = resource_key(b);
 
-  if (mode == output_mode)
-    return mode;
+  if (ka == DebugOutput_Binary || ka == DebugOutput_MappedFile)
+    ka = DebugOutput_File;
 
-  static bool atexit_done = false;
-  if (!atexit_done)
+  if (kb == DebugOutput_Binary || kb == DebugOutput_MappedFile)
+    kb = DebugOutput_File;
+
+#ifdef ACORN_C
+  if (ka == DebugOutput_SessionLog)
+    ka = DebugOutput_SysLog;
+
+  if (kb == DebugOutput_SessionLog)
+    kb = DebugOutput_SysLog;
+#endif
+
+  return (a == b && a != DebugOutput_None) ||
+         (ka == kb && ka != DebugOutput_None);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool sink_holds(DebugOutput output_mode)
+{
+  /* Are the resources needed by an output already open for a sink? */
+  DebugOutput const key = resource_key(output_mode);
+
+  for (size_t i = 0; key != DebugOutput_None && i < nsinks; ++i)
   {
-    atexit(_debug_at_exit);
-    atexit_done = true;
+    if (resource_key(sinks[i].output_mode) == key)
+      return true;
   }
+  return false;
+}
 
-  switch (mode)
+/* ----------------------------------------------------------------------- */
+
+static bool sink_conflicts(DebugOutput output_mode)
+{
+  for (size_t i = 0; i < nsinks; ++i)
+  {
+    if (conflicts(sinks[i].output_mode, output_mode))
+      return true;
+  }
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void close_resources(DebugOutput output_mode)
+{
+  switch (output_mode)
   {
+    case DebugOutput_MappedFile:
+      debug_map_close();
+      /* fallthrough */
     case DebugOutput_FlushedFile:
     case DebugOutput_File:
-      /* Close the log file in <Wimp$ScrapDir> */
+      /* Close the log file */
+      debug_rot_close();
+      if (log_file != NULL)
+      {
+        debug_async_close();
+        debug_sync_close();
+        debug_fd_close();
+        fclose(&*log_file);
+        log_file = NULL;
+      }
+      break;
+
+    case DebugOutput_Binary:
+      /* Close the binary log file */
       if (log_file != NULL)
       {
         fclose(&*log_file);
@@ -136,6 +281,16 @@ DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
       }
       break;
 
+    case DebugOutput_Socket:
+      /* Send any pending lines and end the session */
+      debug_sock_close();
+      break;
+
+    case DebugOutput_Trace:
+      /* Complete the array of trace events */
+      debug_trace_close();
+      break;
+
 #ifdef ACORN_C
     case DebugOutput_SessionLog:
       /* Close the session log and append its data to the main log file */
@@ -151,26 +306,79 @@ DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
       /* Do nothing */
       break;
   }
+}
 
-  DebugOutput const old_mode = mode;
-  mode = output_mode;
+/* ----------------------------------------------------------------------- */
 
-  switch (mode)
+static void close_output(void)
+{
+  close_resources(open_mode);
+  open_mode = DebugOutput_None;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void open_resources(DebugOutput output_mode, const char *log_name)
+{
+  switch (output_mode)
   {
     case DebugOutput_FlushedFile:
     case DebugOutput_File:
+    case DebugOutput_Binary:
+    case DebugOutput_MappedFile:
     {
-      /* Open a file in <Wimp$ScrapDir> to append debugging output */
+      /* Open a file in the log directory to append debugging output */
       char file_path[256];
-      int nout;
-#ifndef OLD_SCL_STUBS
-      nout = snprintf(file_path, sizeof(file_path), "<Wimp$ScrapDir>.%s", log_name);
-#else
-      nout = sprintf(file_path, "<Wimp$ScrapDir>.%s", log_name);
-#endif
-      if (nout > 0 && (size_t)nout < sizeof(file_path))
+      if (debug_make_path(file_path, sizeof(file_path), log_name))
+      {
+        if (output_mode == DebugOutput_Binary)
+        {
+          /* Start a new session, which must define its own call sites */
+          log_file = fopen(file_path, "ab");
+          if (log_file != NULL)
+          {
+            debug_bin_start(&*log_file);
+          }
+        }
+        else if (output_mode == DebugOutput_File &&
+                 debug_rot_open(file_path))
+        {
+          /* Rotating log files are managed separately */
+        }
+        else if (output_mode != DebugOutput_MappedFile ||
+                 !debug_map_open(file_path))
+        {
+          /* Open an ordinary file (also if memory mapping failed) */
+          log_file = fopen(file_path, "a");
+          if (log_file != NULL &&
+              !debug_async_open(&*log_file,
+                                output_mode == DebugOutput_FlushedFile))
+          {
+            if (output_mode == DebugOutput_FlushedFile)
+            {
+              /* Bypass the stream's buffer for complete lines, if possible,
+                 since they must be written promptly anyway */
+              (void)debug_fd_open(&*log_file);
+              debug_sync_open(&*log_file);
+            }
+          }
+        }
+      }
+      break;
+    }
+    case DebugOutput_Socket:
+    {
+      /* Start a session to group lines from this instance together */
+      (void)debug_sock_open(log_name);
+      break;
+    }
+    case DebugOutput_Trace:
+    {
+      /* Create a trace file in the log directory */
+      char file_path[256];
+      if (debug_make_path(file_path, sizeof(file_path), log_name))
       {
-        log_file = fopen(file_path, "a");
+        (void)debug_trace_open(file_path);
       }
       break;
     }
@@ -197,37 +405,191 @@ DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
       break;
     }
   }
-  return old_mode;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void open_output(DebugOutput output_mode, const char *log_name)
+{
+  open_resources(output_mode, log_name);
+  open_mode = output_mode;
+}
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef ACORN_C
+static void report_line(const char *line, size_t len, void *arg)
+{
+  NOT_USED(len);
+  NOT_USED(arg);
+  (void)_swix(Report_Text0, _IN(0), line);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void syslog_line(const char *line, size_t len, void *arg)
+{
+  NOT_USED(len);
+  NOT_USED(arg);
+  (void)_swix(SysLog_LogMessage,
+              _INR(0,2),
+              syslog_handle,
+              line,
+              SYSLOG_PRIORITY);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static DebugLineSink *line_sink(DebugOutput output_mode)
+{
+  return output_mode == DebugOutput_Reporter ? report_line : syslog_line;
 }
 #endif
 
 /* ----------------------------------------------------------------------- */
 
-void debug_printf(const char *format, ...)
+static void write_raw(DebugOutput output_mode, DebugCategory category,
+                      const char *text, size_t len)
 {
-  va_list ap;
+  /* Write preformatted text to an output whose resources are open */
+  switch (output_mode)
+  {
+#ifdef ACORN_C
+    case DebugOutput_SplitStdOut:
+    {
+      /* Issue a VDU command to split the text and graphics cursors */
+      _swix(OS_WriteI+4, 0);
+      /* fallthrough */
+    }
+#endif
+    case DebugOutput_StdOut:
+    {
+      (void)fwrite(text, 1, len, stdout);
+      break;
+    }
+    case DebugOutput_StdErr:
+    {
+      (void)fwrite(text, 1, len, stderr);
+      break;
+    }
+    case DebugOutput_MappedFile:
+      if (debug_map_write(text, len))
+        break;
 
-  va_start(ap, format);
-  debug_vprintf(format, ap);
-  va_end(ap);
+      /* fallthrough */
+    case DebugOutput_FlushedFile:
+    case DebugOutput_File:
+    {
+      if (output_mode == DebugOutput_File && debug_rot_write(text, len))
+      {
+        /* Appended to the current segment of a rotating log file */
+      }
+      else if (log_file != NULL && !debug_async_write(text, len))
+      {
+        if (debug_fd_write(text, len))
+        {
+          /* Already passed to the OS, so there's nothing to flush */
+          if (output_mode == DebugOutput_FlushedFile)
+            (void)debug_sync_written(len);
+        }
+        else
+        {
+          (void)fwrite(text, 1, len, &*log_file);
+          if (output_mode == DebugOutput_FlushedFile &&
+              !debug_sync_written(len))
+          {
+            fflush(&*log_file);
+          }
+        }
+      }
+      break;
+    }
+    case DebugOutput_Binary:
+    {
+      if (log_file != NULL)
+        debug_bin_write(&*log_file, category, text, len);
+      break;
+    }
+#ifdef ACORN_C
+    case DebugOutput_Reporter:
+    case DebugOutput_SysLog:
+    case DebugOutput_SessionLog:
+    {
+      debug_line_write(line_sink(output_mode), text, len);
+      break;
+    }
+#endif
+    case DebugOutput_LineSink:
+    {
+      debug_line_write(NULL, text, len);
+      break;
+    }
+    case DebugOutput_Socket:
+    {
+      debug_line_write(debug_sock_line, text, len);
+      break;
+    }
+    case DebugOutput_Trace:
+    {
+      debug_line_write(debug_trace_line, text, len);
+      break;
+    }
+    default:
+    {
+      /* Do nothing */
+      break;
+    }
+  }
 }
 
 /* ----------------------------------------------------------------------- */
 
-void debug_printfl(const char *format, ...)
+static void call_vprintf(void (*vprintf_fn)(const char *, va_list, bool),
+                         const char *format, ...)
 {
   va_list ap;
 
   va_start(ap, format);
-  debug_vprintf(format, ap);
+  vprintf_fn(format, ap, false);
   va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool write_direct(_Optional const char *prefix, const char *format,
+                         va_list arg, bool newline)
+{
+  /* Gather the prefix, text and line feed into one write to the log file's
+     descriptor, without copying them into the stream's buffer */
+  size_t len;
+  if (!debug_fd_vprintf(prefix, format, arg, newline, &len))
+    return false;
 
-  debug_printf("\n");
+  /* Already passed to the OS, so there's nothing to flush */
+  if (mode == DebugOutput_FlushedFile)
+    (void)debug_sync_written(len);
+
+  return true;
 }
 
 /* ----------------------------------------------------------------------- */
 
-void debug_vprintf(const char *format, va_list arg)
+static void record_prefix(_Optional const DebugStamp *stamp)
+{
+  /* Copy a line's prefix to the recorder */
+  if (stamp != NULL)
+  {
+    char prefix[64];
+    debug_rec_write(prefix, debug_stamp_format(prefix, sizeof(prefix),
+                                               &*stamp));
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_formatted(DebugCategory category,
+                            _Optional const DebugStamp *stamp,
+                            const char *format, va_list arg, bool newline)
 {
   switch (mode)
   {
@@ -243,25 +605,41 @@ void debug_vprintf(const char *format, va_list arg)
     {
       /* Send a string constructed from the format string and variadic
          arguments to the standard output stream */
-      (void)vprintf(format, arg);
+      (void)debug_fmt_vfprintf(stdout, format, arg, newline);
       break;
     }
     case DebugOutput_StdErr:
     {
       /* Send a string constructed from the format string and variadic
          arguments to the standard error stream */
-      (void)vfprintf(stderr, format, arg);
+      (void)debug_fmt_vfprintf(stderr, format, arg, newline);
       break;
     }
+    case DebugOutput_MappedFile:
+      /* Copy a string constructed from the format string and variadic
+         arguments into the memory-mapped log file */
+      if (debug_map_vprintf(format, arg, newline))
+        break;
+
+      /* fallthrough */
     case DebugOutput_FlushedFile:
     case DebugOutput_File:
     {
-      if (log_file != NULL)
+      if (mode == DebugOutput_File &&
+          debug_rot_vprintf(format, arg, newline))
+      {
+        /* Appended to the current segment of a rotating log file */
+      }
+      else if (log_file != NULL &&
+               !debug_async_vprintf(format, arg, newline) &&
+               !write_direct(NULL, format, arg, newline))
       {
         /* Append a string constructed from the format string and variadic
            arguments to the log file */
-        (void)vfprintf(&*log_file, format, arg);
-        if (mode == DebugOutput_FlushedFile)
+        int const nout = debug_fmt_vfprintf(&*log_file, format, arg,
+                                            newline);
+        if (mode == DebugOutput_FlushedFile &&
+            !debug_sync_written(nout > 0 ? (size_t)nout : 0))
         {
           /* Flush the output stream to ensure that all data has been written
              to the log file. */
@@ -270,94 +648,637 @@ void debug_vprintf(const char *format, va_list arg)
       }
       break;
     }
+    case DebugOutput_RingBuffer:
+    {
+      /* Append a string constructed from the format string and variadic
+         arguments to this thread's ring buffer */
+      debug_ring_vprintf(format, arg, newline);
+      break;
+    }
+    case DebugOutput_Binary:
+    {
+      /* Nothing else formats the text, so the recorder must */
+      if (debug_rec_enabled())
+      {
+        record_prefix(stamp);
+        va_list copy;
+        va_copy(copy, arg);
+        debug_rec_vprintf(format, copy, newline);
+        va_end(copy);
+      }
+
+      /* Append a record of the format string and variadic arguments to
+         the binary log file, to be formatted when the log is decoded */
+      if (log_file != NULL)
+        debug_bin_vprintf(&*log_file, category, stamp, format, arg,
+                          newline);
+      break;
+    }
+    case DebugOutput_LineSink:
+    {
+      /* Pass whole lines constructed from the format string and variadic
+         arguments to the client program's function */
+      debug_line_vprintf(NULL, format, arg, newline);
+      break;
+    }
+    case DebugOutput_Socket:
+    {
+      /* Send whole lines constructed from the format string and variadic
+         arguments to the collector */
+      debug_line_vprintf(debug_sock_line, format, arg, newline);
+      break;
+    }
+    case DebugOutput_Trace:
+    {
+      /* Write whole lines constructed from the format string and variadic
+         arguments to the trace file as instant events */
+      debug_line_vprintf(debug_trace_line, format, arg, newline);
+      break;
+    }
 #ifdef ACORN_C
     case DebugOutput_Reporter:
     case DebugOutput_SysLog:
     case DebugOutput_SessionLog:
     {
-      static unsigned int accumulated = 0;
-      static char line[256] = "";
-      char formatted[256];
-      char *readp;
-      int nout;
-
-      /* Generate a string from the format string and variadic arguments */
-#ifndef OLD_SCL_STUBS
-      nout = vsnprintf(formatted, sizeof(formatted), format, arg);
-#else
-      nout = vsprintf(formatted, format, arg);
+      /* Send whole lines constructed from the format string and variadic
+         arguments to the module */
+      debug_line_vprintf(line_sink(mode), format, arg, newline);
+      break;
+    }
 #endif
-      if (nout < 0)
-      {
-        strcpy(formatted, BAD_STRING);
-      }
-      else if ((size_t)nout >= sizeof(formatted))
-      {
-        /* String was truncated to fit in the buffer */
-        strcpy(formatted + sizeof(formatted) - sizeof(TRUNC_STRING),
-               TRUNC_STRING);
-      }
 
-      /* Loop until reaching the end of the string to be output */
-      readp = formatted;
-      while (*readp != '\0')
-      {
-        char   *eol;
-        size_t  len, copied;
+    default:
+    {
+      /* Do nothing */
+      break;
+    }
+  }
+}
 
-        /* Search for the next line feed in the string to be output */
-        eol = strchr(readp, '\n');
-        if (eol == NULL)
-          len = strlen(readp); /* output remainder of string */
-        else
-          len = eol - readp; /* output substring to next line feed */
+/* ----------------------------------------------------------------------- */
 
-        /* Guard against overrunning the end of the buffer
-           by discarding the end of overlong lines */
-        copied = sizeof(line) - 1 - accumulated;
-        if (len < copied)
-          copied = len;
-        (void)strncat(line, readp, copied);
+static void write_text(bool newline, const char *format, ...)
+{
+  va_list ap;
 
-        if (eol == NULL)
-        {
-          /* No more line feeds in the string to be output */
-          accumulated += copied;
-          }
-          else
-          {
-          /* Output the accumulated text line */
-          if (mode == DebugOutput_Reporter)
-          {
-            (void)_swix(Report_Text0, _IN(0), line);
-          }
-          else
-          {
-            (void)_swix(SysLog_LogMessage,
-                        _INR(0,2),
-                        syslog_handle,
-                        line,
-                        SYSLOG_PRIORITY);
-          }
+  va_start(ap, format);
+  write_formatted(DebugCategory_Default, NULL, format, ap, newline);
+  va_end(ap);
+}
 
-          /* Reset the buffer for the start of the next line */
-          accumulated = 0;
-          line[accumulated] = '\0';
-          len ++; /* eat the line feed */
-        }
+/* ----------------------------------------------------------------------- */
 
-        /* Advance the read pointer to the end of the string or next line
-           feed. Not all of the intervening text was necessarily output. */
-        readp += len;
-      }
-      break;
+static void write_prefixed(const DebugStamp *stamp, const char *format,
+                           va_list arg, bool newline)
+{
+  /* Construct the whole line before outputting it, so that the prefix
+     can't be separated from the text that follows it */
+  char prefix[64];
+  (void)debug_stamp_format(prefix, sizeof(prefix), stamp);
+
+  if (mode == DebugOutput_File || mode == DebugOutput_FlushedFile)
+  {
+    va_list copy;
+    va_copy(copy, arg);
+    bool const done = write_direct(prefix, format, copy, newline);
+    va_end(copy);
+
+    if (done)
+      return;
+  }
+
+  char local[256];
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(local, sizeof(local), format, arg);
+
+  if (nout < 0)
+  {
+    write_text(newline, "%s", prefix);
+  }
+  else if ((size_t)nout < sizeof(local))
+  {
+    write_text(newline, "%s%s", prefix, local);
+  }
+  else
+  {
+    _Optional char *const text = malloc((size_t)nout + 1);
+    if (text != NULL)
+    {
+      (void)debug_fmt_vsnprintf(&*text, (size_t)nout + 1, format, copy);
+      write_text(newline, "%s%s", prefix, &*text);
+      free(text);
     }
-#endif
+  }
 
-    default:
+  va_end(copy);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_to(DebugOutput output_mode, DebugCategory category,
+                     const char *text, size_t len)
+{
+  /* The text is terminated, as required to copy it into a ring buffer */
+  if (output_mode == DebugOutput_RingBuffer)
+  {
+    call_vprintf(debug_ring_vprintf, "%s", text);
+  }
+  else
+  {
+    write_raw(output_mode, category, text, len);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool sink_accepts(const DebugSink *sink, DebugCategory category,
+                         DebugLevel level)
+{
+  /* Notices about suppressed output (at DebugLevel_None) go to every sink */
+  return level == DebugLevel_None ||
+         (level <= sink->level &&
+          (sink->categories & DEBUG_CATEGORY_BIT(category)) != 0);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_sinks(DebugCategory category, DebugLevel level,
+                        _Optional const DebugStamp *stamp,
+                        const char *format, va_list arg, bool newline)
+{
+  /* Construct the whole line (including any prefix and line feed) once,
+     then write it to the current output mode and every interested sink */
+  char local[256];
+  size_t prefix_len = 0;
+  if (stamp != NULL)
+  {
+    prefix_len = debug_stamp_format(local, sizeof(local), &*stamp);
+  }
+
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(local + prefix_len,
+                                       sizeof(local) - prefix_len - 1,
+                                       format, arg);
+  if (nout < 0)
+  {
+    va_end(copy);
+    return;
+  }
+
+  char *text = local;
+  _Optional char *big = NULL;
+  size_t len = prefix_len + (size_t)nout;
+
+  if ((size_t)nout >= sizeof(local) - prefix_len - 1)
+  {
+    /* Space is reserved for a line feed and the string terminator */
+    big = malloc(len + 2);
+    if (big == NULL)
     {
-      /* Do nothing */
-      break;
+      va_end(copy);
+      return;
+    }
+    text = &*big;
+    memcpy(text, local, prefix_len);
+    (void)debug_fmt_vsnprintf(text + prefix_len, (size_t)nout + 1, format,
+                              copy);
+  }
+  va_end(copy);
+
+  if (newline)
+  {
+    text[len++] = '\n';
+  }
+  text[len] = '\0';
+
+  /* Keep a copy of recent output regardless of the output mode */
+  debug_rec_write(text, len);
+
+  write_to(mode, category, text, len);
+
+  for (size_t i = 0; i < nsinks; ++i)
+  {
+    if (sink_accepts(&sinks[i], category, level))
+    {
+      write_to(sinks[i].output_mode, category, text, len);
+    }
+  }
+
+  free(big);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_message(DebugCategory category, DebugLevel level,
+                          _Optional const DebugStamp *stamp,
+                          const char *format, va_list arg, bool newline)
+{
+  if (nsinks > 0 ||
+      (mode != DebugOutput_Binary && debug_rec_enabled()))
+  {
+    /* Format the text once for the recorder, output mode and sinks */
+    write_sinks(category, level, stamp, format, arg, newline);
+  }
+  else if (stamp == NULL)
+  {
+    write_formatted(category, NULL, format, arg, newline);
+  }
+  else if (mode == DebugOutput_Binary)
+  {
+    /* Store the prefix as numbers, to be formatted when decoded */
+    write_formatted(category, stamp, format, arg, newline);
+  }
+  else
+  {
+    write_prefixed(&*stamp, format, arg, newline);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void output_notice(DebugLevel level, const char *format, ...)
+{
+  /* Output a line that isn't subject to suppression */
+  va_list ap;
+
+  va_start(ap, format);
+  write_message(DebugCategory_Default, level, NULL, format, ap, true);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void output_line(DebugCategory category, DebugLevel level,
+                        _Optional const DebugStamp *stamp,
+                        const char *format, ...)
+{
+  /* Output a line that isn't subject to suppression */
+  va_list ap;
+
+  va_start(ap, format);
+  write_message(category, level, stamp, format, ap, true);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void output_repeats(unsigned long repeated)
+{
+  if (repeated > 0)
+  {
+    output_notice(DebugLevel_None, "last message repeated %lu time%s",
+                  repeated, repeated == 1 ? "" : "s");
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void output_formatted(DebugCategory category, DebugLevel level,
+                             const char *format, va_list arg, bool newline)
+{
+  unsigned long repeated, suppressed;
+  va_list copy;
+
+  va_copy(copy, arg);
+  bool const allow = debug_limit_check(format, copy, newline, &repeated,
+                                       &suppressed);
+  va_end(copy);
+
+  output_repeats(repeated);
+  if (allow)
+  {
+    if (suppressed > 0)
+    {
+      output_notice(DebugLevel_None, "%lu message%s suppressed by rate limit",
+                    suppressed, suppressed == 1 ? "" : "s");
+    }
+
+    DebugStamp stamp;
+    bool const prefixed = debug_stamp_take(&stamp, format, newline);
+    write_message(category, level, prefixed ? &stamp : NULL, format, arg,
+                  newline);
+  }
+}
+
+#ifdef DEBUG_OUTPUT
+/* ----------------------------------------------------------------------- */
+
+static void _debug_at_exit(void)
+{
+  /* Called at exit to ensure that any open session log or file is closed */
+  debug_remove_sinks();
+  debug_set_output(DebugOutput_None, "");
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void initialise(void)
+{
+  static bool atexit_done = false;
+  if (!atexit_done)
+  {
+    atexit(_debug_at_exit);
+    atexit_done = true;
+
+    _Optional const char *const levels = getenv(LEVELS_VAR);
+    if (levels != NULL)
+    {
+      (void)debug_set_levels(&*levels);
     }
   }
 }
+
+/* ----------------------------------------------------------------------- */
+
+static void remove_conflicting_sinks(DebugOutput output_mode)
+{
+  size_t kept = 0;
+
+  for (size_t i = 0; i < nsinks; ++i)
+  {
+    if (conflicts(sinks[i].output_mode, output_mode))
+    {
+      close_resources(sinks[i].output_mode);
+    }
+    else
+    {
+      sinks[kept++] = sinks[i];
+    }
+  }
+  nsinks = kept;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
+{
+  assert(output_mode < DebugOutput_LAST);
+  assert(log_name != NULL);
+
+  if (mode == output_mode)
+    return mode;
+
+  initialise();
+
+  output_repeats(debug_limit_flush(true));
+  close_output();
+
+  /* A sink can't share its resources with the new output mode */
+  remove_conflicting_sinks(output_mode);
+
+  DebugOutput const old_mode = mode;
+  mode = output_mode;
+  STRCPY_SAFE(log_name_copy, log_name);
+
+  /* Ring buffers are written to other outputs only on demand */
+  if (mode != DebugOutput_RingBuffer)
+  {
+    open_output(mode, log_name);
+  }
+  return old_mode;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_add_sink(DebugOutput output_mode, const char *log_name,
+                    unsigned long categories, DebugLevel level)
+{
+  assert(output_mode < DebugOutput_LAST);
+  assert(log_name != NULL);
+  assert(level < DebugLevel_LAST);
+
+  initialise();
+
+  if (output_mode == DebugOutput_None || nsinks >= ARRAY_SIZE(sinks) ||
+      conflicts(output_mode, mode) || conflicts(output_mode, open_mode) ||
+      sink_conflicts(output_mode))
+  {
+    return false;
+  }
+
+  /* Ring buffers are written to other outputs only on demand */
+  if (output_mode != DebugOutput_RingBuffer)
+  {
+    open_resources(output_mode, log_name);
+  }
+
+  DebugSink *const sink = &sinks[nsinks++];
+  sink->output_mode = output_mode;
+  sink->categories = categories;
+  sink->level = level;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_remove_sinks(void)
+{
+  output_repeats(debug_limit_flush(true));
+
+  while (nsinks > 0)
+  {
+    close_resources(sinks[--nsinks].output_mode);
+  }
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+void debug_printf(const char *format, ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  debug_vprintf(format, ap);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_printfl(const char *format, ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  output_formatted(DebugCategory_Default, DebugLevel_Info, format, ap, true);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_vprintf(const char *format, va_list arg)
+{
+  output_formatted(DebugCategory_Default, DebugLevel_Info, format, arg,
+                   false);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_log_printf(DebugCategory category, DebugLevel level,
+                      const char *format, ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  debug_log_vprintf(category, level, format, ap);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_log_printfl(DebugCategory category, DebugLevel level,
+                       const char *format, ...)
+{
+  assert(category < DebugCategory_LAST);
+  assert(level < DebugLevel_LAST);
+
+  va_list ap;
+
+  va_start(ap, format);
+  output_formatted(category, level, format, ap, true);
+  va_end(ap);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_log_vprintf(DebugCategory category, DebugLevel level,
+                       const char *format, va_list arg)
+{
+  assert(category < DebugCategory_LAST);
+  assert(level < DebugLevel_LAST);
+
+  output_formatted(category, level, format, arg, false);
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_set_log_dir(const char *dir)
+{
+  assert(dir != NULL);
+
+  if (strlen(dir) >= sizeof(log_dir))
+    return false;
+
+  strcpy(log_dir, dir);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_log_kv(DebugCategory category, const char *event,
+                  const DebugKV *pairs, size_t count)
+{
+  assert(category < DebugCategory_LAST);
+  assert(event != NULL);
+  assert(pairs != NULL || count == 0);
+
+  if (mode == DebugOutput_None && nsinks == 0 && !debug_rec_enabled())
+    return;
+
+  DebugStamp stamp;
+  bool const prefixed = debug_stamp_take(&stamp, event, true);
+  bool const binary = mode == DebugOutput_Binary && nsinks == 0;
+
+  if (binary)
+  {
+    /* Record the values, to be formatted when the log is decoded */
+    if (log_file != NULL)
+      debug_bin_kv(&*log_file, category, prefixed ? &stamp : NULL, event,
+                   pairs, count);
+
+    if (!debug_rec_enabled())
+      return;
+  }
+
+  char local[256];
+  const char *text = local;
+  _Optional char *big = NULL;
+  size_t const len = debug_kv_format(local, sizeof(local), event, pairs,
+                                     count);
+  if (len >= sizeof(local))
+  {
+    big = malloc(len + 1);
+    if (big == NULL)
+      return;
+
+    (void)debug_kv_format(&*big, len + 1, event, pairs, count);
+    text = &*big;
+  }
+
+  if (binary)
+  {
+    /* Nothing else formats the text, so the recorder must */
+    record_prefix(prefixed ? &stamp : NULL);
+    debug_rec_write(text, len);
+    debug_rec_write("\n", 1);
+  }
+  else
+  {
+    output_line(category, DebugLevel_Data, prefixed ? &stamp : NULL, "%s",
+                text);
+  }
+
+  free(big);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_make_path(char *buffer, size_t size, const char *leaf_name)
+{
+  assert(buffer != NULL);
+  assert(leaf_name != NULL);
+
+  /* The directory set by the client program overrides the environment */
+  const char *dir = log_dir;
+  if (*dir == '\0')
+  {
+    _Optional const char *const env_dir = getenv(LOG_DIR_VAR);
+    dir = env_dir != NULL && *env_dir != '\0' ? &*env_dir : LOG_DIR_DEFAULT;
+  }
+
+  int nout;
+#ifndef OLD_SCL_STUBS
+  nout = snprintf(buffer, size, "%s" DIR_SEPARATOR "%s", dir, leaf_name);
+#else
+  if (strlen(dir) + strlen(leaf_name) + 1 >= size)
+    return false;
+
+  nout = sprintf(buffer, "%s" DIR_SEPARATOR "%s", dir, leaf_name);
+#endif
+  return nout > 0 && (size_t)nout < size;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_flush_repeats(void)
+{
+  output_repeats(debug_limit_flush(false));
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_output_text(DebugOutput output_mode, const char *text, size_t len)
+{
+  assert(output_mode < DebugOutput_LAST);
+  assert(output_mode != DebugOutput_RingBuffer);
+  assert(text != NULL);
+
+  if (resource_key(output_mode) != resource_key(open_mode) &&
+      !sink_holds(output_mode))
+  {
+    /* Only borrow the resources needed by the specified output if they
+       aren't in use by the current output mode or any sink. */
+    if (resource_key(mode) != DebugOutput_None ||
+        sink_conflicts(output_mode))
+      return;
+
+    close_output();
+    open_output(output_mode, log_name_copy);
+  }
+
+  write_raw(output_mode, DebugCategory_Default, text, len);
+}
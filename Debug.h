@@ -60,6 +60,61 @@ History:
                   and to prevent unintended association with 'else' blocks.
   CJB: 17-May-26: Changed variable name 's' to avoid shadowed variable
                   declaration warnings when assert() is used.
+  CJB: 16-Oct-26: Added DebugOutput_RingBuffer and functions to drain the
+                  ring buffers used in that mode.
+                  Added an asynchronous mode for output to a log file, in
+                  which text is written by a background thread.
+                  Added DebugOutput_Binary and a function to decode the
+                  binary log files written in that mode.
+                  Added categories and levels of debugging output that can
+                  be enabled or disabled at run time. Assertion failures
+                  are reported at DebugLevel_Error.
+                  Added DebugOutput_MappedFile.
+                  Added a flight recorder which keeps the most recent
+                  debugging output and is dumped to a file upon assertion
+                  failure.
+                  Added functions to suppress repeated lines and limit the
+                  rate of output from each call site.
+                  Lines output in DebugOutput_FlushedFile mode are committed
+                  to stable storage in groups. Added a function to get
+                  statistics about group commits.
+                  Added the DEBUG_SAMPLED and DEBUG_ONCE macros, which count
+                  every time they are reached.
+                  Added DebugOutput_LineSink mode, which passes whole lines
+                  to a function registered by the client program.
+                  Added debug_log_kv and the DEBUG_KV macro to output
+                  structured records of typed key/value pairs at the new
+                  level DebugLevel_Data.
+                  Lines can be prefixed with the time, the interval since
+                  the previous line and an identifier of the thread.
+                  Added debug_set_rotation.
+                  Added DebugOutput_Socket mode, which sends lines to a
+                  local collector.
+                  Added a registry that identifies call sites by small
+                  integers, and DEBUG_KV_SITE to record them compactly.
+                  Added debug_add_sink to send output to several destinations
+                  at once, each with its own category and level filter. The
+                  DEBUG_LOG macros pass their category and level to new
+                  functions debug_log_printf, etc.
+                  Added debug_set_log_dir to choose where log files are
+                  created.
+                  Added debug_hexdump and the DEBUG_HEXDUMP macros.
+                  Added DEBUG_TIME_SCOPE, DEBUG_TIME_BEGIN and DEBUG_TIME_END
+                  to record the durations of regions of code in histograms,
+                  and debug_time_report to output their percentiles.
+                  Added DebugOutput_Trace mode and the DEBUG_TRACE_BEGIN,
+                  DEBUG_TRACE_END and DEBUG_TRACE_INSTANT macros.
+                  Assertion failures are counted for each assertion, and
+                  can be reported without terminating the program. Fatal
+                  failures are reported with a backtrace, where supported,
+                  by async-signal-safe system calls.
+                  Added debug_bin_read to read binary logs one record at a
+                  time, and debug_get_category_name.                  Documented that format strings used in DebugOutput_Binary
+                  mode must not be modified or freed.
+                  Assertion failures are counted by file and line instead of
+                  in a static object at each assertion.
+                  Hits on call sites of DEBUG_SAMPLED and DEBUG_ONCE are
+                  counted in the same way.
 */
 
 #ifndef Debug_h
@@ -67,6 +122,9 @@ History:
 
 /* ISO library headers */
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 
@@ -110,10 +168,7 @@ do \
 { \
   if (!(e)) \
   { \
-    char const *const s_private__ = #e; \
-    DEBUG("Assertion %s failed in function %s at " LOCATION, s_private__, __func__); \
-    (void)s_private__; \
-    abort(); \
+    DEBUG_ASSERT_FAILED(#e, __func__); \
   } \
 } \
 while(0)
@@ -123,10 +178,7 @@ do \
 { \
   if (!(e)) \
   { \
-    char const *const s_private__ = #e; \
-    DEBUG("Assertion %s failed at " LOCATION, s_private__); \
-    (void)s_private__; \
-    abort(); \
+    DEBUG_ASSERT_FAILED(#e, NULL); \
   } \
 } \
 while(0)
@@ -140,10 +192,11 @@ typedef enum
                                (VDU, unless redirected) */
   DebugOutput_StdErr,       /* To standard error stream
                                (VDU, unless redirected) */
-  DebugOutput_File,         /* Append to a file in <Wimp$ScrapDir>
-                               (buffered, fast but may lose data in crash) */
-  DebugOutput_FlushedFile,  /* Append to a file in <Wimp$ScrapDir>
-                               (unbuffered, slow but more secure) */
+  DebugOutput_File,         /* Append to a file in the log directory
+                               (fast but may lose data in crash) */
+  DebugOutput_FlushedFile,  /* Append to a file in the log directory
+                               (committed within a time limit, slower but
+                               more secure) */
 #ifdef ACORN_C
   DebugOutput_SplitStdOut,  /* Standard output stream
                                (first splitting text and graphics cursors) */
@@ -152,22 +205,327 @@ typedef enum
   DebugOutput_SessionLog,   /* To Doggysoft/Gerph's SysLog module
                                (session log to group output from this task) */
 #endif
+  DebugOutput_RingBuffer,   /* To a lock-free ring buffer for each thread
+                               (fastest, but must be drained explicitly) */
+  DebugOutput_Binary,       /* Append records to a file in the log directory
+                               (formatting is deferred until decoded; format
+                               strings must not be modified or freed) */
+  DebugOutput_MappedFile,   /* Append to a memory-mapped file in the log
+                               directory (fast, and text survives a
+                               crash of the program but not of the OS) */
+  DebugOutput_LineSink,     /* To a function registered by debug_set_line_sink
+                               (a whole line at a time) */
+  DebugOutput_Socket,       /* To a local datagram socket, like SysLog
+                               (session log to group output from this task) */
+  DebugOutput_Trace,        /* To a file in the log directory as a timeline
+                               of trace events, with DEBUG_TRACE_BEGIN and
+                               DEBUG_TRACE_END spans (Chrome/Perfetto) */
   DebugOutput_LAST
 }
 DebugOutput;
 
+typedef enum
+{
+  DebugQueuePolicy_Block,      /* Wait until the writer thread makes room */
+  DebugQueuePolicy_DropNewest, /* Discard the text being output */
+  DebugQueuePolicy_DropOldest  /* Discard the oldest buffer of queued text */
+}
+DebugQueuePolicy;
+
+typedef struct
+{
+  unsigned long commits;    /* Number of times the log file was committed */
+  unsigned long lines;      /* Total number of lines committed */
+  unsigned long last_lines; /* Number of lines in the most recent commit */
+  unsigned long max_lines;  /* Largest number of lines in one commit */
+}
+DebugCommitStats;
+
+/* Region of code timed by DEBUG_TIME_SCOPE or DEBUG_TIME_BEGIN */
+typedef struct
+{
+  const char      *name;
+  volatile size_t  id;      /* Assigned when first timed (for internal use) */
+}
+DebugTimeRegion;
+
+/* Timing of a region that ends with the enclosing block */
+typedef struct
+{
+  DebugTimeRegion    *region;
+  unsigned long long  start;
+}
+DebugTimeScope;
+
+/* Items with which to prefix each line of debugging output */
+typedef enum
+{
+  DebugPrefix_None   = 0,
+  DebugPrefix_Time   = 1 << 0, /* Seconds since prefixes were enabled */
+  DebugPrefix_Delta  = 1 << 1, /* Seconds since the previous prefixed line */
+  DebugPrefix_Thread = 1 << 2  /* Small number identifying the thread */
+}
+DebugPrefix;
+
+/* Function to receive a line of debugging output, without its line feed
+   but with a string terminator */
+typedef void DebugLineSink(const char */*line*/, size_t /*len*/,
+                           void */*arg*/);
+
+typedef enum
+{
+  DebugLevel_None = 0,      /* Only for use with debug_set_level */
+  DebugLevel_Error,         /* Assertion failures and other fatal errors */
+  DebugLevel_Warning,       /* Problems that can be recovered from */
+  DebugLevel_Info,          /* DEBUG, DEBUGF and DEBUGFL */
+  DebugLevel_Verbose,       /* DEBUG_VERBOSE, DEBUG_VERBOSEF, etc. */
+  DebugLevel_Data,          /* DEBUG_KV (disabled by default) */
+  DebugLevel_LAST
+}
+DebugLevel;
+
+typedef enum
+{
+  DebugKVType_Int,          /* value.i */
+  DebugKVType_UInt,         /* value.u */
+  DebugKVType_Bool,         /* value.b */
+  DebugKVType_Double,       /* value.d */
+  DebugKVType_Ptr,          /* value.p */
+  DebugKVType_Str,          /* value.s (may be null) */
+  DebugKVType_Site          /* value.site (output as "file:line") */
+}
+DebugKVType;
+
+/* Maximum number of call sites that can be registered */
+#define DEBUG_SITE_ID_MAX 1024
+
+/* Identifier of a registered call site, from 1 to DEBUG_SITE_ID_MAX,
+   or 0 if unknown */
+typedef unsigned int DebugSiteId;
+
+typedef struct
+{
+  const char    *file;
+  unsigned long  line;
+  const char    *func;     /* empty string if not registered */
+  const char    *location; /* "file:line" */
+}
+DebugSiteInfo;
+
+/* A typed key/value pair in a structured record. The key must be a string
+   literal (or otherwise have static storage duration). */
+typedef struct
+{
+  const char  *key;
+  DebugKVType  type;
+  union
+  {
+    long long           i;
+    unsigned long long  u;
+    bool                b;
+    double              d;
+    const void         *p;
+    const char         *s;
+    DebugSiteId         site;
+  }
+  value;
+}
+DebugKV;
+
+#define DEBUG_KV_INT(key, v) { (key), DebugKVType_Int, { .i = (v) } }
+#define DEBUG_KV_UINT(key, v) { (key), DebugKVType_UInt, { .u = (v) } }
+#define DEBUG_KV_BOOL(key, v) { (key), DebugKVType_Bool, { .b = (v) } }
+#define DEBUG_KV_DOUBLE(key, v) { (key), DebugKVType_Double, { .d = (v) } }
+#define DEBUG_KV_PTR(key, v) { (key), DebugKVType_Ptr, { .p = (v) } }
+#define DEBUG_KV_STR(key, v) { (key), DebugKVType_Str, { .s = (v) } }
+#define DEBUG_KV_SITE(key, v) { (key), DebugKVType_Site, { .site = (v) } }
+
+/* Datagram socket to which DebugOutput_Socket sends lines, unless another
+   path is given by the environment variable CBDEBUG_SOCKET */
+#define DEBUG_SOCKET_PATH "/tmp/CBDebugLib.sock"
+
+typedef enum
+{
+  DebugCategory_Default = 0, /* Modules that don't define DEBUG_CATEGORY */
+  DebugCategory_PseudoEvnt,
+  DebugCategory_PseudoExit,
+  DebugCategory_PseudoFlex,
+  DebugCategory_PseudoIO,
+  DebugCategory_PseudoKern,
+  DebugCategory_PseudoTbox,
+  DebugCategory_PseudoWimp,
+  DebugCategory_User,        /* First application-defined category */
+  DebugCategory_LAST = 32
+}
+DebugCategory;
+
+/* The category of debugging output produced by the DEBUG macros. To assign
+   a module's output to another category, define this macro before
+   including Debug.h. */
+#ifndef DEBUG_CATEGORY
+#define DEBUG_CATEGORY DebugCategory_Default
+#endif
+
+/* Sets of categories of debugging output to be written to a sink */
+#define DEBUG_CATEGORY_BIT(category) (1ul << (category))
+#define DEBUG_ALL_CATEGORIES 0xfffffffful
+
+/* A record read from a log file written in DebugOutput_Binary mode */
+typedef struct
+{
+  DebugCategory       category;
+  unsigned int        prefix;   /* DebugPrefix values of the fields below */
+  unsigned long long  time_us;
+  unsigned long long  delta_us;
+  unsigned long       thread;
+  const char         *site;     /* Format string or event name (or null if
+                                   the text was recorded preformatted) */
+  const char         *text;     /* Decoded text, without prefix or line feed */
+  size_t              len;
+  bool                newline;
+  const DebugKV      *pairs;    /* Key/value pairs of a structured record */
+  size_t              count;
+}
+DebugLogRecord;
+
+/* Function to be called for each record read from a binary log file */
+typedef void DebugLogReader(const DebugLogRecord */*record*/, void */*arg*/);
+
+/* Set of enabled levels for each category, with bit n representing level n.
+   Use debug_set_level or debug_set_levels instead of writing to this. */
+extern unsigned int debug_levels[DebugCategory_LAST];
+
+static inline bool debug_enabled(DebugCategory category, DebugLevel level)
+{
+  return (debug_levels[category] & (1u << level)) != 0;
+}
+
 #ifdef DEBUG_OUTPUT
 
-#define DEBUGFL(...) debug_printfl(__VA_ARGS__)
-#define DEBUGF(...) debug_printf(__VA_ARGS__)
-#define DEBUGVF(...) debug_vprintf(__VA_ARGS__)
+/* A disabled call site costs one test and doesn't evaluate its arguments */
+#define DEBUG_LOGFL(category, level, ...) \
+  do { if (debug_enabled(category, level)) \
+         debug_log_printfl(category, level, __VA_ARGS__); } while(0)
+#define DEBUG_LOGF(category, level, ...) \
+  do { if (debug_enabled(category, level)) \
+         debug_log_printf(category, level, __VA_ARGS__); } while(0)
+#define DEBUG_LOGVF(category, level, ...) \
+  do { if (debug_enabled(category, level)) \
+         debug_log_vprintf(category, level, __VA_ARGS__); } while(0)
+
+#define DEBUG_ABORT() debug_abort()
+
+/* Count a failure of the assertion at the call site, and report it. No
+   object is defined at the call site, so that assertions can be used in
+   inline functions, but assertions on the same line share one counter. */
+#define DEBUG_ASSERT_FAILED(expression, function) \
+  debug_assert_failed(DEBUG_CATEGORY, expression, __FILE__, __LINE__, \
+                      function)
+
+#define DEBUGFL(...) DEBUG_LOGFL(DEBUG_CATEGORY, DebugLevel_Info, __VA_ARGS__)
+#define DEBUGF(...) DEBUG_LOGF(DEBUG_CATEGORY, DebugLevel_Info, __VA_ARGS__)
+#define DEBUGVF(...) DEBUG_LOGVF(DEBUG_CATEGORY, DebugLevel_Info, __VA_ARGS__)
 #define DEBUG_SET_OUTPUT(output_mode, log_name) debug_set_output(output_mode, log_name)
 
+/* Count every time the call site is reached but only output every nth time
+   (starting with the first), or only the first time if n is 0. No object
+   is defined at the call site, so that these can be used in inline
+   functions, but call sites on the same line share one counter. */
+#define DEBUG_SAMPLED(n, ...) \
+do \
+{ \
+  if (debug_site_hit(__FILE__, __LINE__, (n)) && \
+      debug_enabled(DEBUG_CATEGORY, DebugLevel_Info)) \
+    debug_log_printfl(DEBUG_CATEGORY, DebugLevel_Info, __VA_ARGS__); \
+} \
+while(0)
+#define DEBUG_ONCE(...) DEBUG_SAMPLED(0, __VA_ARGS__)
+
+/* Output a structured record, e.g.
+   DEBUG_KV("alloc", DEBUG_KV_PTR("anchor", a), DEBUG_KV_INT("size", n)) */
+#define DEBUG_KV(event, ...) \
+do \
+{ \
+  if (debug_enabled(DEBUG_CATEGORY, DebugLevel_Data)) \
+  { \
+    const DebugKV kv_private__[] = { __VA_ARGS__ }; \
+    debug_log_kv(DEBUG_CATEGORY, (event), kv_private__, \
+                 sizeof(kv_private__) / sizeof(kv_private__[0])); \
+  } \
+} \
+while(0)
+
+/* Output the contents of a block of memory in hexadecimal, e.g.
+   DEBUG_LOG_HEXDUMP(DEBUG_CATEGORY, DebugLevel_Data, buffer, size) */
+#define DEBUG_LOG_HEXDUMP(category, level, data, len) \
+  do { if (debug_enabled(category, level)) \
+         debug_hexdump(category, level, data, len); } while(0)
+#define DEBUG_HEXDUMP(data, len) \
+  DEBUG_LOG_HEXDUMP(DEBUG_CATEGORY, DebugLevel_Info, data, len)
+
+/* Record how long a region of code takes, e.g.
+     DEBUG_TIME_BEGIN(redraw);
+     ...
+     DEBUG_TIME_END(redraw);
+   in the same block, where 'redraw' is an identifier naming the region.
+   These are declarations, so DEBUG_TIME_BEGIN must appear where a
+   declaration is allowed. */
+#define DEBUG_TIME_BEGIN(tag) \
+  static DebugTimeRegion debug_region_##tag##__ = {#tag, 0}; \
+  unsigned long long const debug_start_##tag##__ = \
+    debug_time_begin(&debug_region_##tag##__)
+#define DEBUG_TIME_END(tag) \
+  debug_time_end(&debug_region_##tag##__, debug_start_##tag##__)
+
+/* Record how long it takes to reach the end of the enclosing block, e.g.
+   DEBUG_TIME_SCOPE("redraw"). Only compilers that can call a function
+   when a variable goes out of scope (GNU C and Clang) support this;
+   elsewhere it does nothing. */
+#if defined(__GNUC__) || defined(__clang__)
+#define DEBUG_TIME_SCOPE(name) DEBUG_TIME_SCOPE_AT(name, __LINE__)
+#define DEBUG_TIME_SCOPE_AT(name, line) DEBUG_TIME_SCOPE_AT2(name, line)
+#define DEBUG_TIME_SCOPE_AT2(name, line) \
+  static DebugTimeRegion debug_region_##line##__ = {name, 0}; \
+  DebugTimeScope debug_scope_##line##__ \
+    __attribute__((cleanup(debug_time_scope_end))) = \
+    {&debug_region_##line##__, debug_time_begin(&debug_region_##line##__)}
+#else
+#define DEBUG_TIME_SCOPE(name) do {} while(0)
+#endif
+
+/* Mark the start and end of a span on the timeline, or a single moment,
+   in DebugOutput_Trace mode, e.g.
+     DEBUG_TRACE_BEGIN("redraw");
+     ...
+     DEBUG_TRACE_END("redraw");
+   Spans on the same thread must be properly nested. */
+#define DEBUG_TRACE_BEGIN(name) debug_trace_begin(name)
+#define DEBUG_TRACE_END(name) debug_trace_end(name)
+#define DEBUG_TRACE_INSTANT(name) debug_trace_instant(name)
+
 #else /* DEBUG_OUTPUT */
 
+#define DEBUG_LOGFL(category, level, ...) do {} while(0)
+#define DEBUG_LOGF(category, level, ...) do {} while(0)
+#define DEBUG_LOGVF(category, level, ...) do {} while(0)
+
+#define DEBUG_ABORT() abort()
+#define DEBUG_ASSERT_FAILED(expression, function) abort()
+
 #define DEBUGFL(...) do {} while(0)
 #define DEBUGF(...) do {} while(0)
 #define DEBUGVF(...) do {} while(0)
+#define DEBUG_SAMPLED(n, ...) do {} while(0)
+#define DEBUG_ONCE(...) do {} while(0)
+#define DEBUG_KV(event, ...) do {} while(0)
+#define DEBUG_LOG_HEXDUMP(category, level, data, len) do {} while(0)
+#define DEBUG_HEXDUMP(data, len) do {} while(0)
+#define DEBUG_TIME_BEGIN(tag) do {} while(0)
+#define DEBUG_TIME_END(tag) do {} while(0)
+#define DEBUG_TIME_SCOPE(name) do {} while(0)
+#define DEBUG_TRACE_BEGIN(name) do {} while(0)
+#define DEBUG_TRACE_END(name) do {} while(0)
+#define DEBUG_TRACE_INSTANT(name) do {} while(0)
 
 static inline DebugOutput debug_set_output(DebugOutput output_mode, const char *log_name)
 {
@@ -177,13 +535,27 @@ static inline DebugOutput debug_set_output(DebugOutput output_mode, const char *
 }
 #define DEBUG_SET_OUTPUT(output_mode, log_name) debug_set_output(output_mode, log_name)
 
+static inline bool debug_add_sink(DebugOutput output_mode, const char *log_name,
+                                  unsigned long categories, DebugLevel level)
+{
+  (void)output_mode;
+  (void)log_name;
+  (void)categories;
+  (void)level;
+  return false;
+}
+
+static inline void debug_remove_sinks(void)
+{
+}
+
 #endif /* DEBUG_OUTPUT */
 
 #if defined(DEBUG_VERBOSE_OUTPUT) && defined (DEBUG_OUTPUT)
 
-#define DEBUG_VERBOSEFL(...) debug_printfl(__VA_ARGS__)
-#define DEBUG_VERBOSEF(...) debug_printf(__VA_ARGS__)
-#define DEBUG_VERBOSEVF(...) debug_vprintf(__VA_ARGS__)
+#define DEBUG_VERBOSEFL(...) DEBUG_LOGFL(DEBUG_CATEGORY, DebugLevel_Verbose, __VA_ARGS__)
+#define DEBUG_VERBOSEF(...) DEBUG_LOGF(DEBUG_CATEGORY, DebugLevel_Verbose, __VA_ARGS__)
+#define DEBUG_VERBOSEVF(...) DEBUG_LOGVF(DEBUG_CATEGORY, DebugLevel_Verbose, __VA_ARGS__)
 
 #else /* DEBUG_VERBOSE_OUTPUT && DEBUG_OUTPUT */
 
@@ -195,18 +567,56 @@ static inline DebugOutput debug_set_output(DebugOutput output_mode, const char *
 
 #define DEBUG(...) DEBUGFL(__VA_ARGS__)
 #define DEBUG_VERBOSE(...) DEBUG_VERBOSEFL(__VA_ARGS__)
+#define DEBUG_ERROR(...) DEBUG_LOGFL(DEBUG_CATEGORY, DebugLevel_Error, __VA_ARGS__)
+#define DEBUG_WARNING(...) DEBUG_LOGFL(DEBUG_CATEGORY, DebugLevel_Warning, __VA_ARGS__)
 
 DebugOutput debug_set_output(DebugOutput  /*output_mode*/,
                              const char  */*log_name*/);
    /*
     * Configures how debugging text should subsequently be output by the
-    * debug_printf function (e.g. appended to a file in <Wimp$ScrapDir>, sent
+    * debug_printf function (e.g. appended to a file in the log directory, sent
     * to Martin Avison's 'Reporter' module, or a system log). The log name
     * should probably be the name of the application being debugged so that it
     * doesn't get mixed up with output from other applications.
     * Returns: The previous output mode (in case it needs to be restored).
     */
 
+bool debug_add_sink(DebugOutput    /*output_mode*/,
+                    const char    */*log_name*/,
+                    unsigned long  /*categories*/,
+                    DebugLevel     /*level*/);
+   /*
+    * Sends debugging output to another destination as well as that
+    * configured by debug_set_output, but only if its category is one of
+    * those in the given set (DEBUG_ALL_CATEGORIES or a combination of
+    * DEBUG_CATEGORY_BIT values) and its level is no more verbose than the
+    * given level, e.g. DebugOutput_StdErr for warnings only and
+    * DebugOutput_File for everything. Output must also be enabled by
+    * debug_set_level. Each message is formatted only once, however many
+    * sinks it is written to. Sinks should be added before other threads
+    * start to produce debugging output.
+    * Returns: false if too many sinks have been added or the output can't
+    *          be used at the same time as the current output mode or
+    *          another sink (e.g. two kinds of log file, which would share
+    *          the same name). Sinks that conflict with a new output mode
+    *          are removed by debug_set_output.
+    */
+
+void debug_remove_sinks(void);
+   /*
+    * Removes all sinks added by debug_add_sink, closing any files or logs
+    * that they opened.
+    */
+
+bool debug_set_log_dir(const char */*dir*/);
+   /*
+    * Sets the directory in which log files (and recorder dumps) are
+    * subsequently created, overriding the CBDEBUG_LOG_DIR environment
+    * variable (CBDebug$LogDir on RISC OS). Pass an empty string to restore
+    * the default, which is <Wimp$ScrapDir> on RISC OS and /tmp elsewhere.
+    * Returns: false if the directory name is too long.
+    */
+
 void debug_printf(const char */*format*/, ...) CHECK_PRINTF(1, 2);
    /*
     * Equivalent to the standard ANSI C library function printf except that
@@ -228,6 +638,411 @@ void debug_vprintf(const char */*format*/, va_list /*arg*/) CHECK_PRINTF(1, 0);
     * debug_set_output.
     */
 
+void debug_log_printf(DebugCategory  /*category*/,
+                      DebugLevel     /*level*/,
+                      const char    */*format*/, ...) CHECK_PRINTF(3, 4);
+   /*
+    * Equivalent to debug_printf except that the output can be directed to
+    * sinks by its category and level. debug_printf, debug_printfl and
+    * debug_vprintf treat their output as DebugCategory_Default at
+    * DebugLevel_Info. Used by the DEBUG_LOG macros.
+    */
+
+void debug_log_printfl(DebugCategory  /*category*/,
+                       DebugLevel     /*level*/,
+                       const char    */*format*/, ...) CHECK_PRINTF(3, 4);
+   /*
+    * Equivalent to debug_printfl except that the output can be directed to
+    * sinks by its category and level.
+    */
+
+void debug_log_vprintf(DebugCategory  /*category*/,
+                       DebugLevel     /*level*/,
+                       const char    */*format*/,
+                       va_list        /*arg*/) CHECK_PRINTF(3, 0);
+   /*
+    * Equivalent to debug_vprintf except that the output can be directed to
+    * sinks by its category and level.
+    */
+
+void debug_set_level(DebugCategory /*category*/, DebugLevel /*level*/);
+   /*
+    * Enables debugging output in the specified category at the specified
+    * level and all more important levels, and disables it at less important
+    * levels. Pass DebugLevel_None to disable all output in the category.
+    * All levels except DebugLevel_Data are enabled initially in all
+    * categories.
+    */
+
+void debug_set_category_name(DebugCategory /*category*/,
+                             const char */*name*/);
+   /*
+    * Sets the name by which an application-defined category can be
+    * configured using debug_set_levels. The string is not copied.
+    */
+
+const char *debug_get_category_name(DebugCategory /*category*/);
+   /*
+    * Gets the name by which a category can be configured using
+    * debug_set_levels.
+    * Returns: null if the category has no name.
+    */
+
+bool debug_set_levels(const char */*spec*/);
+   /*
+    * Sets the levels of debugging output from a comma-separated list of
+    * items such as "PseudoFlex=verbose,PseudoWimp=off". Each item consists
+    * of a category name, or '*' for all categories, an equals sign and a
+    * level name (off, error, warning, info, verbose or data). A level name alone
+    * applies to all categories. Items are applied from left to right. When
+    * debug_set_output is first called, it applies the value of the
+    * environment variable CBDEBUG_LEVELS (CBDebug$Levels on RISC OS), if set.
+    * Returns: false if the list is malformed, in which case no levels are
+    *          changed.
+    */
+
+bool debug_set_recorder(size_t /*size*/, const char */*dump_name*/);
+   /*
+    * Sets the capacity, in bytes, of the flight recorder which keeps the
+    * most recent debugging output regardless of the output mode, and the
+    * name of the file in the log directory to which it is dumped. The size is
+    * rounded up to a power of two; 0 disables the recorder. By default, the
+    * recorder holds 16 KB and is dumped to "DebugDump". Must be called
+    * before any debugging output is produced.
+    * Returns: false if text was already recorded or memory couldn't be
+    *          allocated, in which case nothing is changed.
+    */
+
+bool debug_dump_recorder(void);
+   /*
+    * Writes the content of the flight recorder to its dump file, replacing
+    * any previous content, starting with the oldest complete line.
+    * Returns: false if the recorder is disabled or the file couldn't be
+    *          written.
+    */
+
+void debug_abort(void);
+   /*
+    * Dumps the flight recorder to a file and then terminates
+    * the program by calling abort. Called upon fatal assertion failure if
+    * DEBUG_OUTPUT is defined.
+    */
+
+void debug_assert_failed(DebugCategory /*category*/,
+                         const char */*expression*/,
+                         const char */*file*/, unsigned long /*line*/,
+                         const char */*function*/);
+   /*
+    * Counts a failure of the assertion at the given file and line, and adds
+    * it to the list output by debug_dump_assertions if it didn't fail
+    * before. Assertions are registered by debug_site_intern (so the strings
+    * must outlive the program) and failures aren't counted if the registry
+    * is full. Unless failures are
+    * set to be counted and continued from, the failure and a backtrace
+    * (where supported) are written to the standard error stream using only
+    * async-signal-safe system calls, then output as an error in the usual
+    * way (which also copies them to the flight recorder), and then
+    * debug_abort is called. Otherwise, the 1st, 2nd, 4th, 8th (etc.)
+    * failure of each assertion is output as an error. Called upon assertion
+    * failure if DEBUG_OUTPUT is defined. Backtraces only name functions
+    * that aren't exported if the program is linked with -rdynamic.
+    */
+
+void debug_set_assert_continue(bool /*enable*/);
+   /*
+    * Sets whether the program continues after an assertion fails, e.g. in
+    * soak tests that should find every failing assertion. By default, the
+    * program continues only if the environment variable CBDEBUG_ASSERTS
+    * (or CBDebug$Asserts on RISC OS) is "continue".
+    */
+
+void debug_dump_assertions(void);
+   /*
+    * Outputs the location, expression, function and failure count of every
+    * assertion that has failed, most recently failed first.
+    */
+
+void debug_set_repeat_suppression(bool /*enable*/);
+   /*
+    * Enables or disables suppression of repeated lines. When enabled, a line
+    * that is identical to the previous line and was output by the same call
+    * site (i.e. using the same format string) is discarded, and "last
+    * message repeated N times" is output before the next different line.
+    * Only text that ends with a line feed is eligible. Disabled by default.
+    */
+
+void debug_set_rate_limit(unsigned int /*per_second*/,
+                          unsigned int /*burst*/);
+   /*
+    * Limits the rate at which each call site (i.e. format string) can output
+    * lines to 'per_second', on average, with bursts of up to 'burst' lines.
+    * Excess lines are discarded and counted, and the count is reported
+    * before the next line from the same call site. Only text that ends with
+    * a line feed is limited. Pass 0 to remove the limit (the default).
+    */
+
+void debug_log_kv(DebugCategory   /*category*/,
+                  const char     */*event*/,
+                  const DebugKV  */*pairs*/,
+                  size_t          /*count*/);
+   /*
+    * Outputs a structured record in the given category at DebugLevel_Data,
+    * consisting of an event name and an array of 'count' typed key/value
+    * pairs, with the same prefix as other lines. The event name must be a
+    * string literal (or otherwise have static storage duration). In
+    * DebugOutput_Binary mode the record is stored compactly, with each name
+    * and key written only once per session; in other modes it is output as
+    * a line of JSON, e.g. {"event":"alloc","anchor":"0x8004","size":16}.
+    * Records aren't subject to suppression of repeated lines or rate limits.
+    */
+
+void debug_hexdump(DebugCategory  /*category*/,
+                   DebugLevel     /*level*/,
+                   const void    */*data*/,
+                   size_t         /*len*/);
+   /*
+    * Outputs 'len' bytes of data in hexadecimal, 16 bytes per line, in the
+    * same format as 'hexdump -C': each line has the offset of its first
+    * byte, the bytes in hexadecimal and the same bytes as text (with '.' in
+    * place of unprintable characters). Each line is output separately, so
+    * that prefixes and sinks behave as for any other line.
+    */
+
+unsigned long long debug_time_begin(DebugTimeRegion */*region*/);
+   /*
+    * Notes the start of a timed region. Used by DEBUG_TIME_BEGIN and
+    * DEBUG_TIME_SCOPE.
+    * Returns: the current time, to be passed to debug_time_end.
+    */
+
+void debug_time_end(DebugTimeRegion */*region*/,
+                    unsigned long long /*start*/);
+   /*
+    * Records the duration of a timed region in the calling thread's
+    * histogram for that region. Regions with the same name share a
+    * histogram. Used by DEBUG_TIME_END.
+    */
+
+void debug_time_scope_end(DebugTimeScope */*scope*/);
+   /*
+    * Records the duration of a region timed by DEBUG_TIME_SCOPE. Called
+    * automatically at the end of the enclosing block.
+    */
+
+void debug_time_report(void);
+   /*
+    * Outputs the number of times that each region was timed and the median,
+    * 99th percentile and maximum of its durations, combining the histograms
+    * of all threads. Percentiles are accurate to within 12.5%.
+    */
+
+void debug_trace_begin(const char */*name*/);
+   /*
+    * Writes an event marking the start of a span of time spent by the
+    * calling thread, if DebugOutput_Trace is the output mode or a sink.
+    * Used by DEBUG_TRACE_BEGIN.
+    */
+
+void debug_trace_end(const char */*name*/);
+   /*
+    * Writes an event marking the end of the span most recently started by
+    * the calling thread, if DebugOutput_Trace is the output mode or a sink.
+    * Used by DEBUG_TRACE_END.
+    */
+
+void debug_trace_instant(const char */*name*/);
+   /*
+    * Writes an event marking a moment in the calling thread, if
+    * DebugOutput_Trace is the output mode or a sink. Each line of
+    * debugging text sent to DebugOutput_Trace is also written as such an
+    * event. Used by DEBUG_TRACE_INSTANT.
+    */
+
+void debug_set_prefix(unsigned int /*flags*/);
+   /*
+    * Sets which items (any combination of DebugPrefix values) to output at
+    * the start of each line, e.g. "12.345678 +0.000120 T2 ". Output is
+    * assumed to start a new line if the previous output from the same thread
+    * was by debug_printfl or had a format string ending in a line feed.
+    * Times are measured in microseconds from when prefixes were enabled,
+    * using a cheap processor counter where available. In DebugOutput_Binary
+    * mode, prefixes are stored as numbers and formatted when the log is
+    * decoded.
+    */
+
+void debug_set_line_sink(DebugLineSink */*sink*/, void */*arg*/);
+   /*
+    * Sets the function to which whole lines of text are passed in
+    * DebugOutput_LineSink mode, and a value to be passed to it with each
+    * line. Each thread's text is accumulated separately until it outputs a
+    * line feed, so lines are never mixed or truncated, and the function may
+    * be called concurrently by different threads. It must not output
+    * debugging text itself.
+    */
+
+bool debug_site_hit(const char */*file*/, unsigned long /*line*/,
+                    unsigned long /*period*/);
+   /*
+    * Counts a hit on the call site of DEBUG_SAMPLED or DEBUG_ONCE at the
+    * given file and line, and adds the site to the list output by
+    * debug_dump_sites if it wasn't reached before. Sites are registered by
+    * debug_site_intern, so the file name must outlive the program.
+    * Returns: true if this hit should produce output, i.e. if it is the
+    *          first, or a multiple of 'period' hits after the first, or if
+    *          the site can't be registered.
+    */
+
+void debug_dump_sites(void);
+   /*
+    * Outputs the location and hit count of every call site of DEBUG_SAMPLED
+    * or DEBUG_ONCE that has been reached, most recently reached first.
+    */
+
+DebugSiteId debug_site_intern(const char */*file*/, unsigned long /*line*/,
+                              const char */*func*/);
+   /*
+    * Registers a call site identified by a file name, line number and
+    * function name (which may be null), unless it was already registered. The
+    * strings are compared by value but not copied, so they must be string
+    * literals (e.g. __FILE__ and __func__) or otherwise outlive the program.
+    * Identifiers are allocated in order from 1, so they can be used to
+    * index tables of per-site data. Registering a site is fast enough to
+    * be done every time the site is reached.
+    * Returns: the site's identifier, or 0 if the registry is full or
+    *          memory ran out.
+    */
+
+bool debug_site_info(DebugSiteId /*id*/, DebugSiteInfo */*info*/);
+   /*
+    * Gets the details of a call site registered by debug_site_intern.
+    * Returns: false if no site has the given identifier.
+    */
+
+void debug_ring_set_size(size_t /*size*/);
+   /*
+    * Sets the capacity, in bytes, of ring buffers subsequently created for
+    * threads that produce debugging output in DebugOutput_RingBuffer mode.
+    * The size is rounded up to a power of two. Existing buffers are not
+    * resized.
+    */
+
+size_t debug_ring_pull(char */*buffer*/, size_t /*size*/);
+   /*
+    * Removes whole records of pending text from the ring buffers used in
+    * DebugOutput_RingBuffer mode and copies them into the given buffer,
+    * stopping before the first record that won't fit. Records are produced
+    * by individual calls to debug_vprintf. Text from each thread is copied
+    * in order, but output from different threads isn't interleaved. The
+    * copied text is not NUL terminated.
+    * Returns: The number of characters copied.
+    */
+
+size_t debug_ring_flush(DebugOutput /*output_mode*/);
+   /*
+    * Removes all pending text from the ring buffers used in
+    * DebugOutput_RingBuffer mode and writes it to the specified output. The
+    * log name last passed to debug_set_output is used to open a file or log
+    * if required. Ring buffers are only written to the current output mode,
+    * or to an output that doesn't conflict with it.
+    * Returns: The number of characters removed.
+    */
+
+size_t debug_ring_get_lost(void);
+   /*
+    * Gets the number of characters discarded because a ring buffer was full
+    * when debug_vprintf was called in DebugOutput_RingBuffer mode.
+    * Returns: The total number of characters lost from all threads.
+    */
+
+bool debug_set_async(bool /*enable*/, size_t /*queue_size*/,
+                     DebugQueuePolicy /*policy*/);
+   /*
+    * Enables or disables asynchronous output to log files. In asynchronous
+    * mode, DebugOutput_File and DebugOutput_FlushedFile text is copied into
+    * a bounded queue of 'queue_size' bytes and written in batches by a
+    * background thread. The policy controls what happens when the queue is
+    * full. Takes effect the next time a log file is opened by
+    * debug_set_output.
+    * Returns: false if asynchronous output isn't supported on this platform.
+    */
+
+void debug_set_rotation(size_t /*size*/, unsigned int /*files*/,
+                        bool /*gzip*/);
+   /*
+    * Enables rotation of the DebugOutput_File log file once it reaches
+    * 'size' bytes (or disables it, if 'size' is 0). When the log is rotated,
+    * it is renamed with the suffix ".1", any older logs are renamed with
+    * their suffix incremented, and logs beyond the number given by 'files'
+    * are deleted. If 'gzip' is true then the newest old log is compressed.
+    * Rotation is done by a background thread, so writers never wait for it
+    * (although the log may briefly exceed its size limit). Rotating logs
+    * are always written synchronously. Takes effect the next time a log
+    * file is opened by debug_set_output, on platforms with threads.
+    */
+
+void debug_set_flush_limits(unsigned int /*max_ms*/, size_t /*max_bytes*/);
+   /*
+    * Sets the durability guarantee for DebugOutput_FlushedFile mode: text is
+    * committed to the log file within 'max_ms' milliseconds of being output,
+    * or as soon as 'max_bytes' are waiting, whichever is sooner. All lines
+    * output in the meantime share the same commit, which (unless
+    * asynchronous output is enabled) also synchronises the file with stable
+    * storage. On platforms without threads, the log file is flushed after
+    * every line. Asynchronous DebugOutput_File mode only writes text once
+    * a buffer is full or after about a second.
+    */
+
+void debug_get_commit_stats(DebugCommitStats */*stats*/);
+   /*
+    * Gets statistics about the group commits made since the log file was
+    * last opened in DebugOutput_FlushedFile mode. Each call that output text
+    * counts as one line.
+    */
+
+size_t debug_async_get_dropped(void);
+   /*
+    * Gets the number of characters discarded because the queue was full
+    * (or the text was too long) in asynchronous mode.
+    * Returns: The total number of characters discarded.
+    */
+
+size_t debug_sock_get_dropped(void);
+   /*
+    * Gets the number of lines discarded in DebugOutput_Socket mode because
+    * they couldn't be sent (e.g. because no collector was listening) or
+    * were output faster than they could be sent. Each datagram holds one
+    * line, preceded by a session ID unique to each call to debug_set_output
+    * in that mode, the log name and a tab, e.g. "1234.1 MyApp\tHello".
+    * Lines are sent in batches, at most a few tens of milliseconds late.
+    * Returns: The total number of lines discarded.
+    */
+
+bool debug_bin_read(FILE */*in*/, DebugLogReader */*reader*/,
+                    void */*arg*/);
+   /*
+    * Reads a log file written in DebugOutput_Binary mode one record at a
+    * time, and passes each decoded record to the given function with the
+    * given value. The record (including its strings) is only valid until
+    * the function returns. Records are decoded in the same way as by
+    * debug_bin_decode, with the same restrictions.
+    * Returns: false if the input is malformed or memory ran out.
+    */
+
+bool debug_bin_decode(FILE */*in*/, FILE */*out*/);
+   /*
+    * Reads a log file written in DebugOutput_Binary mode and writes the text
+    * that would have been output in DebugOutput_File mode. Each call site's
+    * format string is recorded once and each conversion is then applied to
+    * the recorded argument values, so the log must be decoded on a machine
+    * with the same data representation as the one that wrote it. Call sites
+    * are identified by the address of their format string, so a format
+    * string in a buffer that was modified or reused (e.g. on the stack or
+    * heap) whilst DebugOutput_Binary mode was selected may be decoded with
+    * the wrong text; format strings should have static storage duration.
+    * Arguments for %n conversions are not recorded.
+    * Returns: false if the input is malformed or memory ran out.
+    */
+
 /* Deprecated type and enumeration constant names */
 #define Debug_Output DebugOutput
 #define Debug_Output_Reporter DebugOutput_Reporter
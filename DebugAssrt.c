@@ -0,0 +1,283 @@
+/*
+ * CBDebugLib: Reports and counters for assertion failures
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Fatal failures are also reported through the normal output
+                  path, to reach the log and the flight recorder.
+                  Failures are counted by file and line instead of in a
+                  static object at each assertion, which is not allowed in
+                  an inline function with external linkage.
+*/
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <execinfo.h>
+#define HAVE_BACKTRACE
+#endif
+#endif
+
+/* Assertions are identified by registering their file name, line number
+   and function with debug_site_intern, and failures are counted in a table
+   indexed by the resulting identifier. Each assertion is added to a list
+   the first time it fails, and is never removed. If an assertion can't be
+   registered then its failures can't be counted, so every failure is
+   treated as the first.
+
+   A failure that will terminate the program is first reported without
+   using the normal output path, which might allocate memory, take locks or
+   be the cause of the failure. The report and a backtrace are written to
+   the standard error stream by system calls that are safe to use in a
+   signal handler. glibc's backtrace function loads libgcc (which may
+   allocate memory) the first time it is called, so it is called once at
+   start-up. Names of functions that aren't exported are only shown if the
+   program was linked with -rdynamic.
+
+   Only then is the same report sent through the normal output path, on a
+   best-effort basis, so that it reaches the log and the flight recorder
+   before debug_abort dumps the recorder. */
+#ifdef ACORN_C
+#define ASSERTS_VAR "CBDebug$Asserts"
+#else
+#define ASSERTS_VAR "CBDEBUG_ASSERTS"
+#endif
+
+enum
+{
+  MaxFrames = 64,
+  Mode_Unknown = 0,
+  Mode_Abort,
+  Mode_Continue
+};
+
+static volatile size_t mode;
+static volatile size_t last_failed; /* identifier of assertion, or 0 */
+static size_t next_failed[DEBUG_SITE_ID_MAX];
+static const char *expressions[DEBUG_SITE_ID_MAX];
+static volatile size_t failures[DEBUG_SITE_ID_MAX];
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+#ifdef HAVE_BACKTRACE
+__attribute__((constructor)) static void load_backtrace(void)
+{
+  void *frame;
+  (void)backtrace(&frame, 1);
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+static bool continue_on_failure(void)
+{
+  size_t m = sync_load(&mode);
+  if (m == Mode_Unknown)
+  {
+    /* Let soak tests change the mode without being rebuilt */
+    _Optional const char *const value = getenv(ASSERTS_VAR);
+    m = (value != NULL && strcmp(&*value, "continue") == 0) ?
+        Mode_Continue : Mode_Abort;
+    (void)sync_cas(&mode, Mode_Unknown, m);
+    m = sync_load(&mode);
+  }
+  return m == Mode_Continue;
+}
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef CBDEBUG_POSIX
+static void write_string(int fd, const char *s)
+{
+  size_t len = strlen(s);
+  while (len > 0)
+  {
+    ssize_t const n = write(fd, s, len);
+    if (n <= 0)
+      break;
+
+    s += n;
+    len -= (size_t)n;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_number(int fd, unsigned long n)
+{
+  char buffer[24];
+  size_t i = sizeof(buffer);
+
+  buffer[--i] = '\0';
+  do
+  {
+    buffer[--i] = (char)('0' + n % 10);
+    n /= 10;
+  }
+  while (n > 0 && i > 0);
+
+  write_string(fd, buffer + i);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_report(int fd, const char *expression, const char *file,
+                         unsigned long line, const char *function)
+{
+  write_string(fd, "Assertion ");
+  write_string(fd, expression);
+  write_string(fd, " failed");
+  if (function != NULL)
+  {
+    write_string(fd, " in function ");
+    write_string(fd, function);
+  }
+  write_string(fd, " at ");
+  write_string(fd, file);
+  write_string(fd, ":");
+  write_number(fd, line);
+  write_string(fd, "\n");
+
+#ifdef HAVE_BACKTRACE
+  void *frames[MaxFrames];
+  int const nframes = backtrace(frames, MaxFrames);
+  backtrace_symbols_fd(frames, nframes, fd);
+#endif
+}
+#endif /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef HAVE_BACKTRACE
+static void log_backtrace(DebugCategory category)
+{
+  void *frames[MaxFrames];
+  int const nframes = backtrace(frames, MaxFrames);
+
+  /* Unlike backtrace_symbols_fd, this allocates memory */
+  _Optional char **const symbols = backtrace_symbols(frames, nframes);
+  if (symbols == NULL)
+    return;
+
+  for (int i = 0; i < nframes; ++i)
+    debug_log_printfl(category, DebugLevel_Error, "  %s", symbols[i]);
+
+  free(symbols);
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_assert_failed(DebugCategory category, const char *expression,
+                         const char *file, unsigned long line,
+                         const char *function)
+{
+  /* Don't use assert here, to avoid recursion */
+  bool const fatal = !continue_on_failure();
+
+#ifdef CBDEBUG_POSIX
+  /* Report a fatal failure before doing anything that might fail */
+  if (fatal)
+    write_report(STDERR_FILENO, expression, file, line, function);
+#endif
+
+  size_t count = 0;
+  DebugSiteId const id = debug_site_intern(file, line, function);
+  if (id != 0)
+  {
+    count = sync_fetch_add(&failures[id - 1], 1);
+    if (count == 0)
+    {
+      /* Only one thread can see the first failure, so only one thread adds
+         the assertion to the list */
+      expressions[id - 1] = expression;
+      do
+      {
+        next_failed[id - 1] = sync_load(&last_failed);
+      }
+      while (!sync_cas(&last_failed, next_failed[id - 1], id));
+    }
+  }
+
+  if (!fatal)
+  {
+    /* Report the 1st, 2nd, 4th, 8th... failure of each assertion */
+    if ((count & (count + 1)) == 0)
+    {
+      debug_log_printfl(category, DebugLevel_Error,
+                        "Assertion %s failed in function %s at %s:%lu "
+                        "(failure %lu)", expression,
+                        function != NULL ? function : "?",
+                        file, line, (unsigned long)count + 1);
+    }
+    return;
+  }
+
+  debug_log_printfl(category, DebugLevel_Error,
+                    "Assertion %s failed in function %s at %s:%lu",
+                    expression, function != NULL ? function : "?",
+                    file, line);
+#ifdef HAVE_BACKTRACE
+  log_backtrace(category);
+#endif
+
+  debug_abort();
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_set_assert_continue(bool enable)
+{
+  sync_store(&mode, enable ? Mode_Continue : Mode_Abort);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_dump_assertions(void)
+{
+  for (size_t id = sync_load(&last_failed); id != 0;
+       id = next_failed[id - 1])
+  {
+    DebugSiteInfo info;
+    if (!debug_site_info((DebugSiteId)id, &info))
+      continue;
+
+    debug_printfl("%s: %s in function %s: %lu failures",
+                  info.location, expressions[id - 1],
+                  *info.func != '\0' ? info.func : "?",
+                  (unsigned long)sync_load(&failures[id - 1]));
+  }
+}
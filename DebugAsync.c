@@ -0,0 +1,628 @@
+/*
+ * CBDebugLib: Background writer thread for debugging output to a file
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Each batch written in DebugOutput_FlushedFile mode is
+                  committed to storage. Queued text is written on abort.
+                  Dropping the oldest buffer updates the time at which the
+                  oldest pending text was queued.
+*/
+
+/* Needed for fileno, writev, fdatasync and clock_gettime in strict ISO C
+   mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/* Text is queued in a fixed pool of equal-sized buffers. Callers append to
+   the current buffer until it is full, whereupon it joins the queue of
+   buffers waiting to be written. The writer thread takes every waiting
+   buffer (and the current buffer, if its deadline has passed) and writes
+   them with a single call to writev. In DebugOutput_FlushedFile mode, each
+   batch is then committed to storage.
+
+   On abort, any text still queued is written by the aborting thread if it
+   can take the lock without waiting. */
+enum
+{
+  QueueSizeDefault = 256 * 1024,
+  QueueSizeMin = 8 * 1024,
+  BufferCount = 8,
+  FlushMsDefault = 50,
+  FlushBytesDefault = 4096,
+  FileFlushMs = 1000, /* DebugOutput_File makes no durability promise */
+  FormatBufferSize = 512
+};
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+typedef struct
+{
+  char            *data;
+  size_t           used;
+  struct timespec  first; /* when text was first added */
+}
+AsyncBuffer;
+
+/* Configuration, applied when a log file is next opened */
+static bool async_enabled;
+static size_t queue_size = QueueSizeDefault;
+static DebugQueuePolicy queue_policy = DebugQueuePolicy_Block;
+
+/* Durability limits for DebugOutput_FlushedFile (protected by 'lock') */
+static unsigned int flush_ms = FlushMsDefault;
+static size_t flush_bytes = FlushBytesDefault;
+
+/* State of the queue and writer thread (protected by 'lock') */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t room_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static volatile size_t active; /* read without the lock */
+static bool stopping, flushed_mode;
+static int fd = -1;
+static AsyncBuffer buffers[BufferCount];
+static size_t buffer_size;
+static int current = -1;               /* buffer being filled, or -1 */
+static int free_list[BufferCount], free_count;
+static int full_queue[BufferCount], full_head, full_count;
+static size_t pending;                 /* bytes not yet taken by writer */
+static struct timespec oldest;         /* when 'pending' became non-zero */
+static volatile size_t dropped;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void deadline_after(struct timespec *deadline,
+                           const struct timespec *start, unsigned int ms)
+{
+  deadline->tv_sec = start->tv_sec + (time_t)(ms / 1000);
+  deadline->tv_nsec = start->tv_nsec + (long)(ms % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L)
+  {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool deadline_passed(const struct timespec *deadline)
+{
+  struct timespec now;
+  (void)clock_gettime(CLOCK_REALTIME, &now);
+  return now.tv_sec > deadline->tv_sec ||
+         (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_all(struct iovec *iov, int iovcnt)
+{
+  while (iovcnt > 0)
+  {
+    ssize_t const n = writev(fd, iov, iovcnt > IOV_MAX ? IOV_MAX : iovcnt);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      break; /* give up rather than spin */
+    }
+
+    /* Skip past whatever was written, which may be part of a buffer */
+    size_t left = (size_t)n;
+    while (iovcnt > 0 && left >= iov->iov_len)
+    {
+      left -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void commit(void)
+{
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+  (void)fdatasync(fd);
+#else
+  (void)fsync(fd);
+#endif
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void queue_current(void)
+{
+  /* Move the buffer being filled to the back of the queue to be written */
+  assert(current >= 0);
+  full_queue[(full_head + full_count) % BufferCount] = current;
+  full_count++;
+  current = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool work_due(void)
+{
+  if (stopping || full_count > 0)
+    return true;
+
+  if (pending == 0)
+    return false;
+
+  size_t const max_bytes = flushed_mode ? flush_bytes : SIZE_MAX;
+  unsigned int const max_ms = flushed_mode ? flush_ms : FileFlushMs;
+  struct timespec deadline;
+  deadline_after(&deadline, &oldest, max_ms);
+  return pending >= max_bytes || deadline_passed(&deadline);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void *writer_thread(void *arg)
+{
+  NOT_USED(arg);
+
+  pthread_mutex_lock(&lock);
+
+  for (;;)
+  {
+    while (!work_due())
+    {
+      if (pending > 0)
+      {
+        struct timespec deadline;
+        deadline_after(&deadline, &oldest,
+                       flushed_mode ? flush_ms : FileFlushMs);
+        (void)pthread_cond_timedwait(&work_cond, &lock, &deadline);
+      }
+      else
+      {
+        (void)pthread_cond_wait(&work_cond, &lock);
+      }
+    }
+
+    if (stopping && pending == 0)
+      break;
+
+    /* Take every queued buffer, plus the one being filled */
+    int batch[BufferCount], nbatch = 0;
+    while (full_count > 0)
+    {
+      batch[nbatch++] = full_queue[full_head];
+      full_head = (full_head + 1) % BufferCount;
+      full_count--;
+    }
+    if (current >= 0 && buffers[current].used > 0)
+    {
+      batch[nbatch++] = current;
+      current = -1;
+    }
+    pending = 0;
+
+    pthread_mutex_unlock(&lock);
+
+    struct iovec iov[BufferCount];
+    for (int i = 0; i < nbatch; ++i)
+    {
+      iov[i].iov_base = buffers[batch[i]].data;
+      iov[i].iov_len = buffers[batch[i]].used;
+    }
+    write_all(iov, nbatch);
+    if (flushed_mode)
+      commit();
+
+    pthread_mutex_lock(&lock);
+
+    /* Return the written buffers to the pool */
+    for (int i = 0; i < nbatch; ++i)
+    {
+      buffers[batch[i]].used = 0;
+      free_list[free_count++] = batch[i];
+    }
+    pthread_cond_broadcast(&room_cond);
+  }
+
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void enqueue(const char *text, size_t len)
+{
+  pthread_mutex_lock(&lock);
+
+  if (len > buffer_size)
+  {
+    dropped += len - buffer_size;
+    len = buffer_size; /* truncate overlong text */
+  }
+
+  for (;;)
+  {
+    if (current >= 0 && buffers[current].used + len <= buffer_size)
+      break;
+
+    if (current >= 0 && buffers[current].used > 0)
+    {
+      queue_current();
+      pthread_cond_signal(&work_cond);
+    }
+
+    if (free_count > 0)
+    {
+      current = free_list[--free_count];
+      continue;
+    }
+
+    if (queue_policy == DebugQueuePolicy_DropOldest && full_count > 0)
+    {
+      /* Recycle the oldest buffer that the writer hasn't yet taken */
+      current = full_queue[full_head];
+      full_head = (full_head + 1) % BufferCount;
+      full_count--;
+      dropped += buffers[current].used;
+      pending -= buffers[current].used;
+      buffers[current].used = 0;
+
+      /* Any remaining text is in buffers queued after the dropped one */
+      if (full_count > 0)
+        oldest = buffers[full_queue[full_head]].first;
+
+      continue;
+    }
+
+    if (queue_policy == DebugQueuePolicy_Block)
+    {
+      (void)pthread_cond_wait(&room_cond, &lock);
+      continue;
+    }
+
+    /* DebugQueuePolicy_DropNewest, or there was nothing old to drop */
+    dropped += len;
+    pthread_mutex_unlock(&lock);
+    return;
+  }
+
+  AsyncBuffer *const buffer = &buffers[current];
+  if (buffer->used == 0)
+    (void)clock_gettime(CLOCK_REALTIME, &buffer->first);
+
+  memcpy(buffer->data + buffer->used, text, len);
+  buffer->used += len;
+
+  if (pending == 0)
+  {
+    /* Nothing else is pending, so the current buffer was empty */
+    oldest = buffer->first;
+    pthread_cond_signal(&work_cond); /* start the clock */
+  }
+  pending += len;
+
+  if (flushed_mode && pending >= flush_bytes)
+    pthread_cond_signal(&work_cond);
+
+  pthread_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+bool debug_set_async(bool enable, size_t size, DebugQueuePolicy policy)
+{
+  assert(policy >= DebugQueuePolicy_Block);
+  assert(policy <= DebugQueuePolicy_DropOldest);
+
+  async_enabled = enable;
+  queue_size = size < QueueSizeMin ? (size_t)QueueSizeMin : size;
+  queue_policy = policy;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_set_flush_limits(unsigned int max_ms, size_t max_bytes)
+{
+  pthread_mutex_lock(&lock);
+  flush_ms = max_ms;
+  flush_bytes = max_bytes;
+  debug_sync_set_limits(max_ms, max_bytes);
+  pthread_cond_signal(&work_cond); /* deadline may have changed */
+  pthread_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_async_get_dropped(void)
+{
+  return sync_load(&dropped);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_async_open(FILE *file, bool flushed)
+{
+  assert(file != NULL);
+
+  if (!async_enabled || sync_load(&active))
+    return false;
+
+  /* Anything already buffered by the stream must be written first */
+  fflush(file);
+
+  buffer_size = queue_size / BufferCount;
+  free_count = 0;
+  for (int i = 0; i < BufferCount; ++i)
+  {
+    _Optional char *const data = malloc(buffer_size);
+    if (data == NULL)
+    {
+      while (free_count > 0)
+        free(buffers[free_list[--free_count]].data);
+
+      return false; /* stay synchronous */
+    }
+    buffers[i].data = &*data;
+    buffers[i].used = 0;
+    free_list[free_count++] = i;
+  }
+
+  fd = fileno(file);
+  flushed_mode = flushed;
+  stopping = false;
+  current = -1;
+  full_head = full_count = 0;
+  pending = 0;
+
+  if (pthread_create(&writer, NULL, writer_thread, NULL) != 0)
+  {
+    for (int i = 0; i < BufferCount; ++i)
+      free(buffers[i].data);
+
+    return false;
+  }
+
+  sync_store(&active, 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_async_close(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  /* Let the writer drain the queue before it exits */
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+
+  (void)pthread_join(writer, NULL);
+  sync_store(&active, 0);
+
+  for (int i = 0; i < BufferCount; ++i)
+    free(buffers[i].data);
+
+  fd = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_async_abort(void)
+{
+  /* The lock may be held by the thread that is aborting, or by a thread
+     that will never release it */
+  if (!sync_load(&active) || pthread_mutex_trylock(&lock) != 0)
+    return;
+
+  /* Take every queued buffer, plus the one being filled. Any batch being
+     written by the writer thread is older, but may not have been written
+     in full. */
+  struct iovec iov[BufferCount];
+  int niov = 0;
+  while (full_count > 0)
+  {
+    int const b = full_queue[full_head];
+    full_head = (full_head + 1) % BufferCount;
+    full_count--;
+    iov[niov].iov_base = buffers[b].data;
+    iov[niov++].iov_len = buffers[b].used;
+    buffers[b].used = 0;
+    free_list[free_count++] = b;
+  }
+  if (current >= 0 && buffers[current].used > 0)
+  {
+    iov[niov].iov_base = buffers[current].data;
+    iov[niov++].iov_len = buffers[current].used;
+    buffers[current].used = 0;
+  }
+  pending = 0;
+
+  write_all(iov, niov);
+  if (flushed_mode)
+    commit();
+
+  pthread_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_async_write(const char *text, size_t len)
+{
+  if (!sync_load(&active))
+    return false;
+
+  enqueue(text, len);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_async_vprintf(const char *format, va_list arg, bool newline)
+{
+  if (!sync_load(&active))
+    return false;
+
+  /* Format the text before taking the lock, to minimise contention.
+     Space is reserved for the string terminator, which is overwritten
+     by the line feed (if any). */
+  char local[FormatBufferSize];
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(local, sizeof(local), format, arg);
+
+  if (nout >= 0 && (size_t)nout < sizeof(local))
+  {
+    size_t len = (size_t)nout;
+    if (newline)
+      local[len++] = '\n';
+
+    enqueue(local, len);
+  }
+  else if (nout >= 0)
+  {
+    size_t len = (size_t)nout;
+    _Optional char *const text = malloc(len + 1);
+    if (text != NULL)
+    {
+      char *const t = &*text;
+      (void)debug_fmt_vsnprintf(t, len + 1, format, copy);
+      if (newline)
+        t[len++] = '\n';
+
+      enqueue(t, len);
+      free(text);
+    }
+    else
+    {
+      pthread_mutex_lock(&lock);
+      dropped += len;
+      pthread_mutex_unlock(&lock);
+    }
+  }
+
+  va_end(copy);
+  return true;
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+bool debug_set_async(bool enable, size_t size, DebugQueuePolicy policy)
+{
+  NOT_USED(size);
+  NOT_USED(policy);
+  return !enable; /* no threads on this platform */
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_set_flush_limits(unsigned int max_ms, size_t max_bytes)
+{
+  NOT_USED(max_ms);
+  NOT_USED(max_bytes);
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_async_get_dropped(void)
+{
+  return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_async_open(FILE *file, bool flushed)
+{
+  NOT_USED(file);
+  NOT_USED(flushed);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_async_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_async_abort(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_async_write(const char *text, size_t len)
+{
+  NOT_USED(text);
+  NOT_USED(len);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_async_vprintf(const char *format, va_list arg, bool newline)
+{
+  NOT_USED(format);
+  NOT_USED(arg);
+  NOT_USED(newline);
+  return false;
+}
+
+#endif /* CBDEBUG_POSIX */
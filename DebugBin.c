@@ -0,0 +1,1658 @@
+/*
+ * CBDebugLib: Binary debugging output with deferred formatting
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Added records of structured key/value pairs.
+                  Message and text records can store the prefix for a
+                  line (format version 2).
+                  Structured records can refer to registered call sites
+                  (format version 3).
+                  Message and text records can store the category of
+                  output (format version 4).
+                  Added debug_bin_read to decode one record at a time.
+                  Retire call sites at the start of a session instead of
+                  freeing them, because other threads may still use them.
+                  Structured records store the category of output and the
+                  prefix for a line (format version 5).
+                  The precision of %ls conversions limits the number of
+                  wide characters recorded.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <wchar.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* A binary log is a sequence of records, each consisting of a type byte,
+   the length of the payload (as an unsigned LEB128 number) and the
+   payload. Every session starts with a header record, which resets the
+   table of call sites. Unknown record types are skipped.
+
+   The first time a format string is seen, a site record gives it an
+   identifier. Thereafter, each call using it produces a message record
+   containing only that identifier and the raw argument values. Signed
+   integers are zigzag-encoded before being stored as LEB128 numbers;
+   floating-point values are stored in the writer's native representation.
+   Text that cannot be recorded that way is stored preformatted. Sites are
+   identified by the address of the format string, not its contents, so
+   format strings must not be modified or freed.
+
+   The event names and keys of structured records are defined in the same
+   way as format strings. Each value is preceded by the identifier of its
+   key and a type byte; strings are stored with their terminator. The
+   location of a registered call site is likewise defined once and then
+   referred to by its identifier.
+
+   The flags of message, text and structured records are followed by the
+   category of output, unless it is the default, and then by the line's
+   prefix (if any). Structured records only have flags from version 5.
+   Records are decoded into a buffer, so that the caller can filter or
+   reformat them without having to parse text. */
+enum
+{
+  RecordType_Header  = 'H', /* magic, version, data representation */
+  RecordType_Site    = 'S', /* site id, format string */
+  RecordType_Message = 'M', /* site id, flags, argument values */
+  RecordType_Text    = 'T', /* flags, text */
+  RecordType_KV      = 'K', /* flags, name id, count, (key id, type,
+                                 value)... */
+  KVType_Null        = 0xff, /* in place of DebugKVType_Str */
+  RecordFlag_Newline = 1,
+  RecordFlag_Stamp   = 2, /* flags are followed by a prefix */
+  RecordFlag_Category = 4, /* flags are followed by a category */
+  FormatVersion = 5,
+  FormatVersionMin = 1,
+  FormatVersionKVFlags = 5,
+  MaxVarIntSize = 10,
+  MaxHeaderSize = 1 + MaxVarIntSize,
+  LocalBufferSize = 256,
+  SiteTableSizeMin = 64,
+  SiteCacheSize = 64 /* must be a power of two */
+};
+
+#define LOG_MAGIC "CBDebugLog"
+#define ENDIAN_CHECK 0x0102
+
+/* Kinds of argument consumed by a conversion specification */
+typedef enum
+{
+  ArgKind_None,      /* no argument (e.g. %%) */
+  ArgKind_Int,       /* int (including '*' and promoted char/short) */
+  ArgKind_UInt,      /* unsigned int */
+  ArgKind_Long,
+  ArgKind_ULong,
+  ArgKind_LLong,
+  ArgKind_ULLong,
+  ArgKind_IntMax,
+  ArgKind_UIntMax,
+  ArgKind_Size,      /* size_t (stored unsigned, whatever the conversion) */
+  ArgKind_PtrDiff,   /* ptrdiff_t (stored signed, whatever the conversion) */
+  ArgKind_Double,
+  ArgKind_LongDouble,
+  ArgKind_Pointer,   /* void * */
+  ArgKind_String,    /* char * */
+  ArgKind_WChar,     /* wint_t */
+  ArgKind_WString,   /* wchar_t * */
+  ArgKind_Count      /* pointer for %n, which is not stored */
+}
+ArgKind;
+
+typedef struct
+{
+  ArgKind kind;
+  int     precision; /* for ArgKind_String and ArgKind_WString */
+}
+ArgSpec;
+
+enum
+{
+  Precision_None = -1, /* string is NUL terminated */
+  Precision_Star = -2  /* given by preceding ArgKind_Int */
+};
+
+/* A parsed conversion specification */
+typedef struct
+{
+  const char *start;     /* the '%' */
+  size_t      len;       /* length including the conversion specifier */
+  bool        width_star;
+  bool        prec_star;
+  int         precision; /* Precision_None if not given */
+  ArgKind     kind;
+}
+ConvSpec;
+
+typedef struct Site
+{
+  const char *format;
+  _Optional struct Site *retired; /* next site from an earlier session */
+  unsigned long id;
+  bool        text_only; /* arguments can't be recorded */
+  size_t      nargs;
+  ArgSpec     args[];
+}
+Site;
+
+typedef struct
+{
+  unsigned char *data;
+  size_t         size;
+  size_t         used;
+  bool           failed;
+  unsigned char  local[LocalBufferSize];
+}
+ByteBuffer;
+
+typedef struct
+{
+  const char *format;
+  Site       *site;
+  size_t      session;
+}
+SiteCacheEntry;
+
+static DebugMutex site_lock = DEBUG_MUTEX_INIT;
+static _Optional Site **site_table;
+static size_t site_table_size, site_count;
+static _Optional Site *retired_sites; /* kept because threads may use them */
+static volatile size_t session; /* invalidates cached sites when changed */
+static THREAD_LOCAL SiteCacheEntry site_cache[SiteCacheSize];
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void buffer_init(ByteBuffer *buffer)
+{
+  buffer->data = buffer->local;
+  buffer->size = sizeof(buffer->local);
+  buffer->used = MaxHeaderSize; /* leave room for the record header */
+  buffer->failed = false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void buffer_free(ByteBuffer *buffer)
+{
+  if (buffer->data != buffer->local)
+    free(buffer->data);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional unsigned char *buffer_extend(ByteBuffer *buffer, size_t n)
+{
+  if (buffer->failed)
+    return NULL;
+
+  if (n > buffer->size - buffer->used)
+  {
+    size_t new_size = buffer->size * 2;
+    while (n > new_size - buffer->used)
+      new_size *= 2;
+
+    _Optional unsigned char *new_data;
+    if (buffer->data == buffer->local)
+    {
+      new_data = malloc(new_size);
+      if (new_data != NULL)
+        memcpy(&*new_data, buffer->local, buffer->used);
+    }
+    else
+    {
+      new_data = realloc(buffer->data, new_size);
+    }
+
+    if (new_data == NULL)
+    {
+      buffer->failed = true;
+      return NULL;
+    }
+    buffer->data = &*new_data;
+    buffer->size = new_size;
+  }
+
+  unsigned char *const p = buffer->data + buffer->used;
+  buffer->used += n;
+  return p;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_bytes(ByteBuffer *buffer, const void *bytes, size_t n)
+{
+  _Optional unsigned char *const p = buffer_extend(buffer, n);
+  if (p != NULL)
+    memcpy(&*p, bytes, n);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t encode_uint(unsigned char *out, uintmax_t value)
+{
+  size_t n = 0;
+  do
+  {
+    unsigned char byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0)
+      byte |= 0x80;
+    out[n++] = byte;
+  }
+  while (value != 0);
+  return n;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_uint(ByteBuffer *buffer, uintmax_t value)
+{
+  unsigned char tmp[MaxVarIntSize];
+  put_bytes(buffer, tmp, encode_uint(tmp, value));
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_int(ByteBuffer *buffer, intmax_t value)
+{
+  /* Zigzag encoding maps small magnitudes to small unsigned numbers */
+  uintmax_t const u = (uintmax_t)value;
+  put_uint(buffer, value < 0 ? ~(u << 1) : (u << 1));
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_record(FILE *file, int type, ByteBuffer *buffer)
+{
+  /* Write the record header immediately before the payload so that the
+     whole record can be output in one call */
+  unsigned char header[MaxHeaderSize];
+  size_t const payload = buffer->used - MaxHeaderSize;
+
+  header[0] = (unsigned char)type;
+  size_t const hlen = 1 + encode_uint(header + 1, payload);
+  unsigned char *const start = buffer->data + MaxHeaderSize - hlen;
+  memcpy(start, header, hlen);
+
+  if (!buffer->failed)
+    (void)fwrite(start, 1, hlen + payload, file);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static ArgKind int_kind(char length, bool is_signed)
+{
+  switch (length)
+  {
+    case 'l': return is_signed ? ArgKind_Long : ArgKind_ULong;
+    case 'q': return is_signed ? ArgKind_LLong : ArgKind_ULLong;
+    case 'j': return is_signed ? ArgKind_IntMax : ArgKind_UIntMax;
+    case 'z': return ArgKind_Size;
+    case 't': return ArgKind_PtrDiff;
+    default:  return is_signed ? ArgKind_Int : ArgKind_UInt;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool parse_spec(const char *p, ConvSpec *spec)
+{
+  /* Parse a conversion specification starting at the '%' and determine
+     which kind of argument it consumes. Positional arguments and
+     unrecognised conversions are not supported. */
+  spec->start = p++;
+  spec->width_star = spec->prec_star = false;
+  spec->precision = Precision_None;
+
+  while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+    p++;
+
+  if (*p == '*')
+  {
+    spec->width_star = true;
+    p++;
+  }
+  else
+  {
+    while (*p >= '0' && *p <= '9')
+      p++;
+  }
+
+  if (*p == '$')
+    return false;
+
+  if (*p == '.')
+  {
+    p++;
+    if (*p == '*')
+    {
+      spec->prec_star = true;
+      spec->precision = Precision_Star;
+      p++;
+    }
+    else
+    {
+      spec->precision = 0;
+      while (*p >= '0' && *p <= '9')
+        spec->precision = spec->precision * 10 + (*p++ - '0');
+    }
+  }
+
+  /* Length modifier ('q' stands for 'll') */
+  char length = '\0';
+  switch (*p)
+  {
+    case 'h':
+      length = 'h';
+      if (*++p == 'h')
+        p++;
+      break;
+    case 'l':
+      length = 'l';
+      if (*++p == 'l')
+      {
+        length = 'q';
+        p++;
+      }
+      break;
+    case 'j':
+    case 'z':
+    case 't':
+    case 'L':
+      length = *p++;
+      break;
+    default:
+      break;
+  }
+
+  switch (*p)
+  {
+    case '%':
+      spec->kind = ArgKind_None;
+      break;
+    case 'd':
+    case 'i':
+      spec->kind = int_kind(length, true);
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec->kind = int_kind(length, false);
+      break;
+    case 'c':
+      spec->kind = (length == 'l') ? ArgKind_WChar : ArgKind_Int;
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec->kind = (length == 'L') ? ArgKind_LongDouble : ArgKind_Double;
+      break;
+    case 'p':
+      spec->kind = ArgKind_Pointer;
+      break;
+    case 's':
+      spec->kind = (length == 'l') ? ArgKind_WString : ArgKind_String;
+      break;
+    case 'n':
+      spec->kind = ArgKind_Count;
+      break;
+    default:
+      return false;
+  }
+
+  spec->len = (size_t)(p + 1 - spec->start);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional Site *make_site(const char *format, unsigned long id)
+{
+  /* Count the arguments consumed by the format string */
+  size_t nargs = 0;
+  bool text_only = false;
+
+  for (const char *p = strchr(format, '%'); p != NULL; )
+  {
+    ConvSpec spec;
+    if (!parse_spec(p, &spec))
+    {
+      text_only = true;
+      nargs = 0;
+      break;
+    }
+    nargs += spec.width_star + spec.prec_star + (spec.kind != ArgKind_None);
+    p = strchr(p + spec.len, '%');
+  }
+
+  _Optional Site *const optional_site =
+    malloc(sizeof(Site) + nargs * sizeof(ArgSpec));
+  if (optional_site == NULL)
+    return NULL;
+
+  Site *const site = &*optional_site;
+  site->format = format;
+  site->retired = NULL;
+  site->id = id;
+  site->text_only = text_only;
+  site->nargs = nargs;
+
+  /* Record the kind of each argument so that the format string needn't be
+     parsed again */
+  if (!text_only)
+  {
+    size_t n = 0;
+    for (const char *p = strchr(format, '%'); p != NULL; )
+    {
+      ConvSpec spec;
+      (void)parse_spec(p, &spec);
+      if (spec.width_star)
+        site->args[n++] = (ArgSpec){ArgKind_Int, Precision_None};
+      if (spec.prec_star)
+        site->args[n++] = (ArgSpec){ArgKind_Int, Precision_None};
+      if (spec.kind != ArgKind_None)
+        site->args[n++] = (ArgSpec){spec.kind, spec.precision};
+      p = strchr(p + spec.len, '%');
+    }
+  }
+
+  return site;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t hash_pointer(const void *p, size_t size)
+{
+  uintptr_t const h = (uintptr_t)p;
+  return (size_t)((h >> 3) ^ (h >> 11)) & (size - 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool grow_site_table(void)
+{
+  size_t const new_size = site_table_size ? site_table_size * 2
+                                          : (size_t)SiteTableSizeMin;
+  _Optional Site **const new_table = calloc(new_size, sizeof(*new_table));
+  if (new_table == NULL)
+    return false;
+
+  for (size_t i = 0; i < site_table_size; ++i)
+  {
+    _Optional Site *const site = site_table[i];
+    if (site == NULL)
+      continue;
+
+    size_t j = hash_pointer(site->format, new_size);
+    while (new_table[j] != NULL)
+      j = (j + 1) & (new_size - 1);
+    new_table[j] = site;
+  }
+
+  free(site_table);
+  site_table = new_table;
+  site_table_size = new_size;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional Site *find_site(FILE *file, const char *format)
+{
+  /* Find the site record for a format string, creating it (and writing
+     a definition to the log) if it doesn't already exist. Recently used
+     sites are cached per thread to avoid taking the lock. */
+  size_t const current = sync_load(&session);
+  SiteCacheEntry *const entry = &site_cache[hash_pointer(format,
+                                                         SiteCacheSize)];
+  if (entry->format == format && entry->session == current)
+    return entry->site;
+
+  debug_mutex_lock(&site_lock);
+
+  _Optional Site *site = NULL;
+  if (site_table != NULL)
+  {
+    size_t i = hash_pointer(format, site_table_size);
+    while ((site = site_table[i]) != NULL && site->format != format)
+      i = (i + 1) & (site_table_size - 1);
+  }
+
+  if (site == NULL &&
+      (site_count < site_table_size / 2 || grow_site_table()))
+  {
+    site = make_site(format, site_count);
+    if (site != NULL)
+    {
+      size_t i = hash_pointer(format, site_table_size);
+      while (site_table[i] != NULL)
+        i = (i + 1) & (site_table_size - 1);
+      site_table[i] = site;
+      site_count++;
+
+      ByteBuffer buffer;
+      buffer_init(&buffer);
+      put_uint(&buffer, site->id);
+      put_bytes(&buffer, format, strlen(format));
+      write_record(file, RecordType_Site, &buffer);
+      buffer_free(&buffer);
+    }
+  }
+
+  debug_mutex_unlock(&site_lock);
+
+  if (site != NULL)
+  {
+    entry->format = format;
+    entry->site = &*site;
+    entry->session = current;
+  }
+  return site;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_flags(ByteBuffer *buffer, unsigned char flags,
+                      DebugCategory category)
+{
+  if (category != DebugCategory_Default)
+    flags |= RecordFlag_Category;
+
+  put_bytes(buffer, &flags, sizeof(flags));
+
+  if (flags & RecordFlag_Category)
+  {
+    unsigned char const c = (unsigned char)category;
+    put_bytes(buffer, &c, sizeof(c));
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_stamp(ByteBuffer *buffer, const DebugStamp *stamp)
+{
+  unsigned char const sflags = (unsigned char)stamp->flags;
+  put_bytes(buffer, &sflags, sizeof(sflags));
+
+  if (sflags & DebugPrefix_Time)
+    put_uint(buffer, stamp->time_us);
+  if (sflags & DebugPrefix_Delta)
+    put_uint(buffer, stamp->delta_us);
+  if (sflags & DebugPrefix_Thread)
+    put_uint(buffer, stamp->thread);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_args(ByteBuffer *buffer, const Site *site, va_list arg)
+{
+  int last_int = 0;
+
+  for (size_t i = 0; i < site->nargs; ++i)
+  {
+    switch (site->args[i].kind)
+    {
+      case ArgKind_Int:
+        last_int = va_arg(arg, int);
+        put_int(buffer, last_int);
+        break;
+      case ArgKind_UInt:
+        put_uint(buffer, va_arg(arg, unsigned int));
+        break;
+      case ArgKind_Long:
+        put_int(buffer, va_arg(arg, long));
+        break;
+      case ArgKind_ULong:
+        put_uint(buffer, va_arg(arg, unsigned long));
+        break;
+      case ArgKind_LLong:
+        put_int(buffer, va_arg(arg, long long));
+        break;
+      case ArgKind_ULLong:
+        put_uint(buffer, va_arg(arg, unsigned long long));
+        break;
+      case ArgKind_IntMax:
+        put_int(buffer, va_arg(arg, intmax_t));
+        break;
+      case ArgKind_UIntMax:
+        put_uint(buffer, va_arg(arg, uintmax_t));
+        break;
+      case ArgKind_Size:
+        put_uint(buffer, va_arg(arg, size_t));
+        break;
+      case ArgKind_PtrDiff:
+        put_int(buffer, va_arg(arg, ptrdiff_t));
+        break;
+      case ArgKind_Double:
+      {
+        double const d = va_arg(arg, double);
+        put_bytes(buffer, &d, sizeof(d));
+        break;
+      }
+      case ArgKind_LongDouble:
+      {
+        long double const d = va_arg(arg, long double);
+        put_bytes(buffer, &d, sizeof(d));
+        break;
+      }
+      case ArgKind_Pointer:
+        put_uint(buffer, (uintptr_t)va_arg(arg, void *));
+        break;
+      case ArgKind_String:
+      {
+        /* A null pointer is recorded as length 0; otherwise length+1 */
+        const char *const s = va_arg(arg, const char *);
+        if (s == NULL)
+        {
+          put_uint(buffer, 0);
+          break;
+        }
+
+        int const precision = site->args[i].precision == Precision_Star ?
+                              last_int : site->args[i].precision;
+        size_t len;
+        if (precision >= 0)
+        {
+          /* The string needn't be terminated within the precision */
+          _Optional const char *const end = memchr(s, '\0', (size_t)precision);
+          len = end ? (size_t)(&*end - s) : (size_t)precision;
+        }
+        else
+        {
+          len = strlen(s);
+        }
+        put_uint(buffer, (uintmax_t)len + 1);
+        put_bytes(buffer, s, len);
+        break;
+      }
+      case ArgKind_WChar:
+        put_uint(buffer, va_arg(arg, wint_t));
+        break;
+      case ArgKind_WString:
+      {
+        const wchar_t *const s = va_arg(arg, const wchar_t *);
+        if (s == NULL)
+        {
+          put_uint(buffer, 0);
+          break;
+        }
+
+        /* The precision limits the number of bytes output, and no wide
+           character is output as fewer than one byte, so the array
+           needn't be terminated within that many characters */
+        int const precision = site->args[i].precision == Precision_Star ?
+                              last_int : site->args[i].precision;
+        size_t len = 0;
+        while ((precision < 0 || len < (size_t)precision) && s[len] != L'\0')
+          ++len;
+
+        put_uint(buffer, (uintmax_t)len + 1);
+        for (size_t j = 0; j < len; ++j)
+          put_uint(buffer, (uintmax_t)s[j]);
+        break;
+      }
+      case ArgKind_Count:
+        (void)va_arg(arg, void *);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool get_uint(const unsigned char **p, const unsigned char *end,
+                     uintmax_t *value)
+{
+  uintmax_t v = 0;
+  unsigned int shift = 0;
+
+  for (;;)
+  {
+    if (*p >= end || shift >= sizeof(v) * 8)
+      return false;
+
+    unsigned char const byte = *(*p)++;
+    v |= (uintmax_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+    shift += 7;
+  }
+
+  *value = v;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool get_int(const unsigned char **p, const unsigned char *end,
+                    intmax_t *value)
+{
+  uintmax_t u;
+  if (!get_uint(p, end, &u))
+    return false;
+
+  *value = (u & 1) ? -(intmax_t)(u >> 1) - 1 : (intmax_t)(u >> 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool get_bytes(const unsigned char **p, const unsigned char *end,
+                      void *bytes, size_t n)
+{
+  if ((size_t)(end - *p) < n)
+    return false;
+
+  memcpy(bytes, *p, n);
+  *p += n;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void buffer_printf(ByteBuffer *buffer, const char *format, ...)
+{
+  /* Append a formatted string (without its terminator) to a buffer */
+  size_t const room = buffer->failed ? 0 : buffer->size - buffer->used;
+  va_list ap;
+
+  va_start(ap, format);
+  int const nout = vsnprintf((char *)buffer->data + buffer->used, room,
+                             format, ap);
+  va_end(ap);
+
+  if (nout < 0)
+  {
+    buffer->failed = true;
+  }
+  else if ((size_t)nout < room)
+  {
+    buffer->used += (size_t)nout;
+  }
+  else
+  {
+    /* Make room for the whole string and its terminator, then retry */
+    _Optional unsigned char *const p = buffer_extend(buffer,
+                                                     (size_t)nout + 1);
+    if (p != NULL)
+    {
+      va_start(ap, format);
+      (void)vsnprintf((char *)&*p, (size_t)nout + 1, format, ap);
+      va_end(ap);
+      buffer->used--; /* don't count the terminator */
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool decode_conversion(ByteBuffer *out, const ConvSpec *spec,
+                              const unsigned char **p,
+                              const unsigned char *end)
+{
+  /* Rebuild the conversion specification with any '*' replaced by the
+     recorded value and convert the recorded argument with it */
+  char fmt[64];
+  size_t n = 0;
+  intmax_t width = 0, precision = 0;
+
+  if (spec->width_star && !get_int(p, end, &width))
+    return false;
+
+  if (spec->prec_star && !get_int(p, end, &precision))
+    return false;
+
+  if (spec->len + 2 * (3 * sizeof(int)) >= sizeof(fmt))
+    return false;
+
+  for (const char *s = spec->start; s < spec->start + spec->len; ++s)
+  {
+    if (*s == '*')
+    {
+      n += (size_t)sprintf(fmt + n, "%d",
+                           (int)(s[-1] == '.' ? precision : width));
+    }
+    else
+    {
+      fmt[n++] = *s;
+    }
+  }
+  fmt[n] = '\0';
+
+  uintmax_t u = 0;
+  intmax_t i = 0;
+
+  switch (spec->kind)
+  {
+    case ArgKind_None:
+      put_bytes(out, "%", 1);
+      return true;
+    case ArgKind_Int:
+      if (!get_int(p, end, &i))
+        return false;
+      buffer_printf(out, fmt, (int)i);
+      return true;
+    case ArgKind_UInt:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (unsigned int)u);
+      return true;
+    case ArgKind_Long:
+      if (!get_int(p, end, &i))
+        return false;
+      buffer_printf(out, fmt, (long)i);
+      return true;
+    case ArgKind_ULong:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (unsigned long)u);
+      return true;
+    case ArgKind_LLong:
+      if (!get_int(p, end, &i))
+        return false;
+      buffer_printf(out, fmt, (long long)i);
+      return true;
+    case ArgKind_ULLong:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (unsigned long long)u);
+      return true;
+    case ArgKind_IntMax:
+      if (!get_int(p, end, &i))
+        return false;
+      buffer_printf(out, fmt, i);
+      return true;
+    case ArgKind_UIntMax:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, u);
+      return true;
+    case ArgKind_Size:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (size_t)u);
+      return true;
+    case ArgKind_PtrDiff:
+      if (!get_int(p, end, &i))
+        return false;
+      buffer_printf(out, fmt, (ptrdiff_t)i);
+      return true;
+    case ArgKind_Double:
+    {
+      double d;
+      if (!get_bytes(p, end, &d, sizeof(d)))
+        return false;
+      buffer_printf(out, fmt, d);
+      return true;
+    }
+    case ArgKind_LongDouble:
+    {
+      long double d;
+      if (!get_bytes(p, end, &d, sizeof(d)))
+        return false;
+      buffer_printf(out, fmt, d);
+      return true;
+    }
+    case ArgKind_Pointer:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (void *)(uintptr_t)u);
+      return true;
+    case ArgKind_String:
+    {
+      if (!get_uint(p, end, &u))
+        return false;
+      if (u == 0)
+      {
+        buffer_printf(out, fmt, (char *)NULL);
+        return true;
+      }
+      size_t const len = (size_t)u - 1;
+      if ((size_t)(end - *p) < len)
+        return false;
+      _Optional char *const s = malloc(len + 1);
+      if (s == NULL)
+        return false;
+      memcpy(&*s, *p, len);
+      s[len] = '\0';
+      *p += len;
+      buffer_printf(out, fmt, &*s);
+      free(s);
+      return true;
+    }
+    case ArgKind_WChar:
+      if (!get_uint(p, end, &u))
+        return false;
+      buffer_printf(out, fmt, (wint_t)u);
+      return true;
+    case ArgKind_WString:
+    {
+      if (!get_uint(p, end, &u))
+        return false;
+      if (u == 0)
+      {
+        buffer_printf(out, fmt, (wchar_t *)NULL);
+        return true;
+      }
+      size_t const len = (size_t)u - 1;
+      if (len > (size_t)(end - *p))
+        return false;
+      _Optional wchar_t *const s = malloc((len + 1) * sizeof(wchar_t));
+      if (s == NULL)
+        return false;
+      for (size_t j = 0; j < len; ++j)
+      {
+        if (!get_uint(p, end, &u))
+        {
+          free(s);
+          return false;
+        }
+        s[j] = (wchar_t)u;
+      }
+      s[len] = L'\0';
+      buffer_printf(out, fmt, &*s);
+      free(s);
+      return true;
+    }
+    case ArgKind_Count:
+      return true; /* %n outputs nothing */
+    default:
+      return false;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool decode_message(ByteBuffer *out, const char *format,
+                           const unsigned char *p, const unsigned char *end)
+{
+  const char *literal = format;
+
+  for (;;)
+  {
+    _Optional const char *const pc = strchr(literal, '%');
+    size_t const n = pc ? (size_t)(&*pc - literal) : strlen(literal);
+    put_bytes(out, literal, n);
+    if (pc == NULL)
+      break;
+
+    ConvSpec spec;
+    if (!parse_spec(&*pc, &spec) || !decode_conversion(out, &spec, &p, end))
+      return false;
+
+    literal = &*pc + spec.len;
+  }
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool decode_stamp(DebugLogRecord *record, const unsigned char **p,
+                         const unsigned char *end)
+{
+  unsigned char sflags;
+  uintmax_t time_us = 0, delta_us = 0, thread = 0;
+
+  if (!get_bytes(p, end, &sflags, sizeof(sflags)) ||
+      ((sflags & DebugPrefix_Time) && !get_uint(p, end, &time_us)) ||
+      ((sflags & DebugPrefix_Delta) && !get_uint(p, end, &delta_us)) ||
+      ((sflags & DebugPrefix_Thread) && !get_uint(p, end, &thread)))
+  {
+    return false;
+  }
+
+  record->prefix = sflags;
+  record->time_us = time_us;
+  record->delta_us = delta_us;
+  record->thread = (unsigned long)thread;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool decode_flags(DebugLogRecord *record, const unsigned char **p,
+                         const unsigned char *end)
+{
+  /* Decode the flags, category and prefix at the start of a message, text
+     or structured record */
+  unsigned char flags, category = DebugCategory_Default;
+
+  if (!get_bytes(p, end, &flags, sizeof(flags)) ||
+      ((flags & RecordFlag_Category) &&
+       !get_bytes(p, end, &category, sizeof(category))) ||
+      category >= DebugCategory_LAST ||
+      ((flags & RecordFlag_Stamp) && !decode_stamp(record, p, end)))
+  {
+    return false;
+  }
+
+  record->category = (DebugCategory)category;
+  record->newline = (flags & RecordFlag_Newline) != 0;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool decode_kv(DebugLogRecord *record, ByteBuffer *text,
+                      _Optional char *const *names, size_t nnames,
+                      const unsigned char *p, const unsigned char *end,
+                      DebugLogReader *reader, void *arg)
+{
+  uintmax_t id, count;
+  if (!get_uint(&p, end, &id) || id >= nnames || names[id] == NULL ||
+      !get_uint(&p, end, &count) || count > (size_t)(end - p))
+  {
+    return false; /* each pair occupies at least one byte */
+  }
+
+  const char *const event = &*names[id];
+  DebugKV local[16];
+  _Optional DebugKV *pairs = local;
+  if (count > ARRAY_SIZE(local))
+  {
+    pairs = malloc((size_t)count * sizeof(DebugKV));
+    if (pairs == NULL)
+      return false;
+  }
+
+  DebugKV *const kv = &*pairs;
+  bool ok = true;
+  for (size_t i = 0; ok && i < count; ++i)
+  {
+    unsigned char type;
+    if (!get_uint(&p, end, &id) || id >= nnames || names[id] == NULL ||
+        !get_bytes(&p, end, &type, sizeof(type)))
+    {
+      ok = false;
+      break;
+    }
+
+    kv[i].key = &*names[id];
+    kv[i].type = (DebugKVType)type;
+
+    switch (type)
+    {
+      case DebugKVType_Int:
+      {
+        intmax_t v = 0;
+        ok = get_int(&p, end, &v);
+        kv[i].value.i = (long long)v;
+        break;
+      }
+      case DebugKVType_UInt:
+      {
+        uintmax_t v = 0;
+        ok = get_uint(&p, end, &v);
+        kv[i].value.u = (unsigned long long)v;
+        break;
+      }
+      case DebugKVType_Bool:
+      {
+        unsigned char v = 0;
+        ok = get_bytes(&p, end, &v, sizeof(v));
+        kv[i].value.b = v != 0;
+        break;
+      }
+      case DebugKVType_Double:
+        ok = get_bytes(&p, end, &kv[i].value.d, sizeof(kv[i].value.d));
+        break;
+
+      case DebugKVType_Ptr:
+      {
+        uintmax_t v = 0;
+        ok = get_uint(&p, end, &v);
+        kv[i].value.p = (const void *)(uintptr_t)v;
+        break;
+      }
+      case DebugKVType_Str:
+      {
+        _Optional const unsigned char *const nul =
+          memchr(p, '\0', (size_t)(end - p));
+        ok = nul != NULL;
+        if (ok)
+        {
+          kv[i].value.s = (const char *)p;
+          p = &*nul + 1;
+        }
+        break;
+      }
+      case DebugKVType_Site:
+      {
+        /* Output the location that was defined like a format string */
+        uintmax_t v = 0;
+        ok = get_uint(&p, end, &v) && v < nnames && names[v] != NULL;
+        if (ok)
+        {
+          kv[i].type = DebugKVType_Str;
+          kv[i].value.s = &*names[v];
+        }
+        break;
+      }
+      case KVType_Null:
+        kv[i].type = DebugKVType_Str;
+        kv[i].value.s = NULL;
+        break;
+
+      default:
+        ok = false;
+        break;
+    }
+  }
+
+  if (ok)
+  {
+    /* The pairs must be passed on before any storage for them is freed */
+    size_t const len = debug_kv_format(NULL, 0, event, kv, (size_t)count);
+    _Optional unsigned char *const q = buffer_extend(text, len + 1);
+    if (q != NULL)
+    {
+      (void)debug_kv_format((char *)&*q, len + 1, event, kv, (size_t)count);
+      text->used--; /* don't count the terminator */
+
+      record->site = event;
+      record->text = (const char *)text->data;
+      record->len = text->used;
+      record->newline = true;
+      record->pairs = kv;
+      record->count = (size_t)count;
+      reader(record, arg);
+    }
+    else
+    {
+      ok = false;
+    }
+  }
+
+  if (pairs != local)
+    free(pairs);
+
+  return ok;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool pass_text(DebugLogRecord *record, ByteBuffer *text,
+                      DebugLogReader *reader, void *arg)
+{
+  /* Terminate the decoded text and pass the record on */
+  put_bytes(text, "", 1);
+  if (text->failed)
+    return false;
+
+  record->text = (const char *)text->data;
+  record->len = text->used - 1;
+  reader(record, arg);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void print_record(const DebugLogRecord *record, void *arg)
+{
+  /* Write a record as it would have been output in DebugOutput_File mode */
+  FILE *const out = arg;
+
+  if (record->prefix != 0)
+  {
+    DebugStamp const stamp = {record->prefix, record->time_us,
+                              record->delta_us, record->thread};
+    char prefix[64];
+    size_t const len = debug_stamp_format(prefix, sizeof(prefix), &stamp);
+    (void)fwrite(prefix, 1, len, out);
+  }
+
+  (void)fwrite(record->text, 1, record->len, out);
+  if (record->newline)
+    (void)fputc('\n', out);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+bool debug_bin_read(FILE *in, DebugLogReader *reader, void *arg)
+{
+  assert(in != NULL);
+  assert(reader != NULL);
+
+  bool ok = true;
+  _Optional unsigned char *payload = NULL;
+  size_t payload_size = 0;
+  _Optional char **formats = NULL;
+  size_t nformats = 0;
+  bool header_seen = false;
+  uintmax_t version = 0; /* of the current session */
+  ByteBuffer text;
+  buffer_init(&text);
+
+  for (;;)
+  {
+    /* Read the record header */
+    int const type = fgetc(in);
+    if (type == EOF)
+      break;
+
+    uintmax_t len = 0;
+    unsigned int shift = 0;
+    int c;
+    do
+    {
+      c = fgetc(in);
+      if (c == EOF || shift >= sizeof(len) * 8)
+      {
+        ok = false;
+        break;
+      }
+      len |= (uintmax_t)(c & 0x7f) << shift;
+      shift += 7;
+    }
+    while (c & 0x80);
+
+    if (!ok || len > SIZE_MAX - 1)
+    {
+      ok = false;
+      break;
+    }
+
+    /* Read the payload, with room for a terminator */
+    if (len + 1 > payload_size)
+    {
+      _Optional unsigned char *const new_payload =
+        realloc(payload, (size_t)len + 1);
+      if (new_payload == NULL)
+      {
+        ok = false;
+        break;
+      }
+      payload = new_payload;
+      payload_size = (size_t)len + 1;
+    }
+
+    unsigned char *const start = &*payload;
+    if (fread(start, 1, (size_t)len, in) != len)
+    {
+      ok = false;
+      break;
+    }
+    start[len] = '\0';
+
+    const unsigned char *p = start;
+    const unsigned char *const end = start + len;
+
+    DebugLogRecord record = {DebugCategory_Default, 0, 0, 0, 0, NULL, "", 0,
+                             false, NULL, 0};
+    text.used = 0;
+
+    if (type == RecordType_Header)
+    {
+      /* Check the magic and data representation, then forget the
+         previous session's call sites */
+      size_t const mlen = sizeof(LOG_MAGIC) - 1;
+      unsigned short endian;
+      unsigned char dsize, ldsize;
+
+      if (len < mlen || memcmp(p, LOG_MAGIC, mlen) != 0)
+      {
+        ok = false;
+        break;
+      }
+      p += mlen;
+
+      if (!get_uint(&p, end, &version) || version < FormatVersionMin ||
+          version > FormatVersion ||
+          !get_bytes(&p, end, &endian, sizeof(endian)) ||
+          endian != ENDIAN_CHECK ||
+          !get_bytes(&p, end, &dsize, sizeof(dsize)) ||
+          dsize != sizeof(double) ||
+          !get_bytes(&p, end, &ldsize, sizeof(ldsize)) ||
+          ldsize != sizeof(long double))
+      {
+        ok = false;
+        break;
+      }
+
+      for (size_t i = 0; i < nformats; ++i)
+        free(formats[i]);
+
+      nformats = 0;
+      header_seen = true;
+    }
+    else if (!header_seen)
+    {
+      ok = false;
+      break;
+    }
+    else if (type == RecordType_Site)
+    {
+      uintmax_t id;
+      if (!get_uint(&p, end, &id) || id != nformats)
+      {
+        ok = false;
+        break;
+      }
+
+      _Optional char **const new_formats =
+        realloc(formats, (nformats + 1) * sizeof(*formats));
+      if (new_formats == NULL)
+      {
+        ok = false;
+        break;
+      }
+      formats = new_formats;
+
+      size_t const flen = (size_t)(end - p);
+      _Optional char *const format = malloc(flen + 1);
+      if (format == NULL)
+      {
+        ok = false;
+        break;
+      }
+      memcpy(&*format, p, flen + 1); /* includes terminator */
+      formats[nformats++] = format;
+    }
+    else if (type == RecordType_Message)
+    {
+      uintmax_t id;
+      if (!get_uint(&p, end, &id) || id >= nformats || formats[id] == NULL ||
+          !decode_flags(&record, &p, end))
+      {
+        ok = false;
+        break;
+      }
+
+      record.site = &*formats[id];
+      if (!decode_message(&text, record.site, p, end) ||
+          !pass_text(&record, &text, reader, arg))
+      {
+        ok = false;
+        break;
+      }
+    }
+    else if (type == RecordType_Text)
+    {
+      if (!decode_flags(&record, &p, end))
+      {
+        ok = false;
+        break;
+      }
+
+      put_bytes(&text, p, (size_t)(end - p));
+      if (!pass_text(&record, &text, reader, arg))
+      {
+        ok = false;
+        break;
+      }
+    }
+    else if (type == RecordType_KV)
+    {
+      if ((version >= FormatVersionKVFlags &&
+           !decode_flags(&record, &p, end)) ||
+          !decode_kv(&record, &text, formats, nformats, p, end, reader, arg))
+      {
+        ok = false;
+        break;
+      }
+    }
+    /* else skip unknown record type */
+  }
+
+  for (size_t i = 0; i < nformats; ++i)
+    free(formats[i]);
+
+  free(formats);
+  free(payload);
+  buffer_free(&text);
+  return ok;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_bin_decode(FILE *in, FILE *out)
+{
+  assert(in != NULL);
+  assert(out != NULL);
+
+  return debug_bin_read(in, print_record, out);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_bin_start(FILE *file)
+{
+  assert(file != NULL);
+
+  /* Sites defined in any previous session must be defined again. Other
+     threads may still be using the old sites (from their caches or while
+     recording arguments), so they are retired instead of being freed. */
+  debug_mutex_lock(&site_lock);
+  sync_store(&session, session + 1);
+
+  for (size_t i = 0; i < site_table_size; ++i)
+  {
+    _Optional Site *const site = site_table[i];
+    if (site != NULL)
+    {
+      site->retired = retired_sites;
+      retired_sites = site;
+    }
+  }
+
+  free(site_table);
+  site_table = NULL;
+  site_table_size = site_count = 0;
+
+  ByteBuffer buffer;
+  buffer_init(&buffer);
+  put_bytes(&buffer, LOG_MAGIC, sizeof(LOG_MAGIC) - 1);
+  put_uint(&buffer, FormatVersion);
+  unsigned short const endian = ENDIAN_CHECK;
+  put_bytes(&buffer, &endian, sizeof(endian));
+  unsigned char const dsize = sizeof(double), ldsize = sizeof(long double);
+  put_bytes(&buffer, &dsize, sizeof(dsize));
+  put_bytes(&buffer, &ldsize, sizeof(ldsize));
+  write_record(file, RecordType_Header, &buffer);
+  buffer_free(&buffer);
+
+  debug_mutex_unlock(&site_lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_bin_write(FILE *file, DebugCategory category, const char *text,
+                     size_t len)
+{
+  assert(file != NULL);
+  assert(category < DebugCategory_LAST);
+  assert(text != NULL);
+
+  ByteBuffer buffer;
+  buffer_init(&buffer);
+  put_flags(&buffer, 0, category);
+  put_bytes(&buffer, text, len);
+  write_record(file, RecordType_Text, &buffer);
+  buffer_free(&buffer);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_bin_vprintf(FILE *file, DebugCategory category,
+                       _Optional const DebugStamp *stamp,
+                       const char *format, va_list arg, bool newline)
+{
+  assert(file != NULL);
+  assert(category < DebugCategory_LAST);
+  assert(format != NULL);
+
+  _Optional Site *const site = find_site(file, format);
+  unsigned char const flags = (newline ? RecordFlag_Newline : 0) |
+                              (stamp != NULL ? RecordFlag_Stamp : 0);
+  ByteBuffer buffer;
+  buffer_init(&buffer);
+
+  if (site != NULL && !site->text_only)
+  {
+    put_uint(&buffer, site->id);
+    put_flags(&buffer, flags, category);
+    if (stamp != NULL)
+      put_stamp(&buffer, &*stamp);
+    put_args(&buffer, &*site, arg);
+    write_record(file, RecordType_Message, &buffer);
+  }
+  else
+  {
+    /* Fall back to recording preformatted text */
+    va_list copy;
+    va_copy(copy, arg);
+    int const nout = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    put_flags(&buffer, flags, category);
+    if (stamp != NULL)
+      put_stamp(&buffer, &*stamp);
+    if (nout >= 0)
+    {
+      _Optional unsigned char *const p = buffer_extend(&buffer,
+                                                       (size_t)nout + 1);
+      if (p != NULL)
+      {
+        (void)vsnprintf((char *)&*p, (size_t)nout + 1, format, arg);
+        buffer.used--; /* don't record the terminator */
+      }
+    }
+    write_record(file, RecordType_Text, &buffer);
+  }
+
+  buffer_free(&buffer);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_bin_kv(FILE *file, DebugCategory category,
+                  _Optional const DebugStamp *stamp, const char *event,
+                  const DebugKV *pairs, size_t count)
+{
+  assert(file != NULL);
+  assert(category < DebugCategory_LAST);
+  assert(event != NULL);
+  assert(pairs != NULL || count == 0);
+
+  /* Names and keys are defined before the record that refers to them */
+  _Optional Site *const name = find_site(file, event);
+  if (name == NULL)
+    return;
+
+  ByteBuffer buffer;
+  buffer_init(&buffer);
+  put_flags(&buffer, RecordFlag_Newline |
+                     (stamp != NULL ? RecordFlag_Stamp : 0), category);
+  if (stamp != NULL)
+    put_stamp(&buffer, &*stamp);
+  put_uint(&buffer, name->id);
+  put_uint(&buffer, count);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const DebugKV *const kv = &pairs[i];
+    _Optional Site *const key = find_site(file, kv->key);
+    if (key == NULL)
+    {
+      buffer.failed = true;
+      break;
+    }
+
+    put_uint(&buffer, key->id);
+
+    unsigned char type = (unsigned char)kv->type;
+    if (kv->type == DebugKVType_Str && kv->value.s == NULL)
+      type = KVType_Null;
+
+    _Optional Site *location = NULL;
+    if (kv->type == DebugKVType_Site)
+    {
+      DebugSiteInfo info;
+      if (debug_site_info(kv->value.site, &info))
+        location = find_site(file, info.location);
+
+      if (location == NULL)
+        type = KVType_Null;
+    }
+
+    put_bytes(&buffer, &type, sizeof(type));
+
+    switch (type)
+    {
+      case DebugKVType_Int:
+        put_int(&buffer, kv->value.i);
+        break;
+
+      case DebugKVType_UInt:
+        put_uint(&buffer, kv->value.u);
+        break;
+
+      case DebugKVType_Bool:
+      {
+        unsigned char const b = kv->value.b;
+        put_bytes(&buffer, &b, sizeof(b));
+        break;
+      }
+      case DebugKVType_Double:
+        put_bytes(&buffer, &kv->value.d, sizeof(kv->value.d));
+        break;
+
+      case DebugKVType_Ptr:
+        put_uint(&buffer, (uintptr_t)kv->value.p);
+        break;
+
+      case DebugKVType_Str:
+        put_bytes(&buffer, &*kv->value.s, strlen(&*kv->value.s) + 1);
+        break;
+
+      case DebugKVType_Site:
+        put_uint(&buffer, location->id);
+        break;
+
+      default:
+        /* Nothing more to record */
+        break;
+    }
+  }
+
+  write_record(file, RecordType_KV, &buffer);
+  buffer_free(&buffer);
+}
@@ -0,0 +1,268 @@
+/*
+ * CBDebugLib: Debugging output written directly to a file descriptor
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Only complete lines are written directly. Text that can't
+                  be formatted is left to the stream.
+*/
+
+/* Needed for fileno and writev in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <unistd.h>
+#include <sys/uio.h>
+
+/* The stream buffer of a log file written in DebugOutput_FlushedFile mode
+   is bypassed: the prefix, text and line feed of each complete line are
+   gathered by a single call to writev instead of being copied into the
+   stream buffer first. Because the file was opened for appending, each
+   line is added at the end of the file in one piece even if other threads
+   or processes are writing to it. Partial lines are left to the stream, so
+   the stream must be flushed before the rest of the line is written. */
+enum
+{
+  LocalSize = 256 /* longer text is formatted into a heap block */
+};
+
+static volatile size_t active;
+static volatile size_t partial; /* stream may hold part of a line */
+static _Optional FILE *stream;
+static int fd = -1;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static size_t write_all(struct iovec *iov, int iovcnt)
+{
+  size_t total = 0;
+
+  while (iovcnt > 0)
+  {
+    ssize_t const n = writev(fd, iov, iovcnt);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      break; /* give up rather than spin */
+    }
+
+    /* Skip past whatever was written, which may be part of a vector */
+    size_t left = (size_t)n;
+    total += left;
+    while (iovcnt > 0 && left >= iov->iov_len)
+    {
+      left -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+
+    if (iovcnt > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+
+  return total;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool start_line(bool complete)
+{
+  if (!complete)
+  {
+    /* Leave it to the stream to buffer the start of the line */
+    sync_store(&partial, 1);
+    return false;
+  }
+
+  /* Anything in the stream buffer must precede the rest of the line */
+  if (sync_load(&partial))
+  {
+    sync_store(&partial, 0);
+    if (stream != NULL)
+      (void)fflush(&*stream);
+  }
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_fd_open(FILE *file)
+{
+  assert(file != NULL);
+
+  /* Anything already in the stream buffer must precede direct output */
+  if (fflush(file) != 0)
+    return false;
+
+  fd = fileno(file);
+  if (fd < 0)
+    return false;
+
+  stream = file;
+  sync_store(&partial, 0);
+  sync_store(&active, 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_fd_close(void)
+{
+  sync_store(&active, 0);
+  stream = NULL;
+  fd = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_fd_vprintf(_Optional const char *prefix, const char *format,
+                      va_list arg, bool newline, size_t *len)
+{
+  assert(format != NULL);
+  assert(len != NULL);
+
+  if (!sync_load(&active) || !start_line(newline))
+    return false;
+
+  /* Format copies of the arguments, in case they must be left to the
+     stream after all */
+  char local[LocalSize];
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(local, sizeof(local), format, copy);
+  va_end(copy);
+
+  _Optional char *big = NULL;
+  const char *text = local;
+  bool formatted = nout >= 0 && (size_t)nout < sizeof(local);
+
+  if (nout >= 0 && !formatted)
+  {
+    big = malloc((size_t)nout + 1);
+    if (big != NULL)
+    {
+      va_copy(copy, arg);
+      (void)debug_fmt_vsnprintf(&*big, (size_t)nout + 1, format, copy);
+      va_end(copy);
+      text = &*big;
+      formatted = true;
+    }
+  }
+
+  if (formatted)
+  {
+    struct iovec iov[3];
+    int iovcnt = 0;
+
+    if (prefix != NULL && *prefix != '\0')
+    {
+      iov[iovcnt].iov_base = (char *)&*prefix;
+      iov[iovcnt++].iov_len = strlen(&*prefix);
+    }
+
+    iov[iovcnt].iov_base = (char *)text;
+    iov[iovcnt++].iov_len = (size_t)nout;
+    iov[iovcnt].iov_base = "\n";
+    iov[iovcnt++].iov_len = 1;
+
+    *len = write_all(iov, iovcnt);
+  }
+
+  free(big);
+  return formatted;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_fd_write(const char *text, size_t len)
+{
+  assert(text != NULL);
+
+  if (!sync_load(&active) ||
+      !start_line(len > 0 && text[len - 1] == '\n'))
+    return false;
+
+  struct iovec iov = {(char *)text, len};
+  (void)write_all(&iov, 1);
+  return true;
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_fd_open(FILE *file)
+{
+  NOT_USED(file);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_fd_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_fd_vprintf(_Optional const char *prefix, const char *format,
+                      va_list arg, bool newline, size_t *len)
+{
+  NOT_USED(prefix);
+  NOT_USED(format);
+  NOT_USED(arg);
+  NOT_USED(newline);
+  NOT_USED(len);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_fd_write(const char *text, size_t len)
+{
+  NOT_USED(text);
+  NOT_USED(len);
+  return false;
+}
+
+#endif /* CBDEBUG_POSIX */
@@ -0,0 +1,403 @@
+/*
+ * CBDebugLib: Fast formatting of common conversion specifications
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  %p is left to the C library, so that pointers are output
+                  in the same style as by other printf functions.
+                  %p is formatted in glibc's style when glibc is in use.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+
+/* Most debugging output uses only a few simple conversions, which are
+   formatted here without the locale lookups and generality of the C
+   library's printf family. The supported conversions are %c, %d, %i, %u,
+   %x, %X, %s and %%, with the flags '-' and '0', a field width, a
+   precision (for %s only) and the length modifiers 'l', 'll' and 'z'
+   (for unsigned conversions only). If any other conversion is found then
+   the whole string is formatted again by vsnprintf.
+
+   The output of %p is implementation-defined and must match the text
+   decoded from binary logs by the C library, so it is only formatted here
+   if the C library is known to be glibc, which outputs "(nil)" for a null
+   pointer and otherwise the same as %#lx. */
+#ifdef __GLIBC__
+#define FORMAT_POINTERS
+#endif
+
+enum
+{
+  MaxWidth = 4096,  /* wider fields are left to the C library */
+  SmallCopy = 16,
+  LocalSize = 256   /* longer text is written by vfprintf */
+};
+
+typedef struct
+{
+  char  *buffer;
+  size_t size;
+  size_t len; /* number of characters that would have been written */
+}
+FmtWriter;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void put_text(FmtWriter *w, const char *text, size_t n)
+{
+  if (n == 0)
+    return;
+
+  if (w->len < w->size)
+  {
+    /* Most fields are too short to be worth calling memcpy */
+    size_t const room = w->size - w->len;
+    size_t const copy = LOWEST(n, room);
+    char *const dest = w->buffer + w->len;
+    if (copy <= SmallCopy)
+    {
+      for (size_t i = 0; i < copy; ++i)
+        dest[i] = text[i];
+    }
+    else
+    {
+      memcpy(dest, text, copy);
+    }
+  }
+  w->len += n;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_fill(FmtWriter *w, char c, size_t n)
+{
+  if (n == 0)
+    return;
+
+  if (w->len < w->size)
+  {
+    size_t const room = w->size - w->len;
+    memset(w->buffer + w->len, c, LOWEST(n, room));
+  }
+  w->len += n;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_field(FmtWriter *w, const char *sign, size_t sign_len,
+                      const char *text, size_t n, size_t width, bool left,
+                      bool zero)
+{
+  /* Pad the sign (or prefix) and text to the field width */
+  size_t const pad = width > sign_len + n ? width - sign_len - n : 0;
+
+  if (left)
+  {
+    put_text(w, sign, sign_len);
+    put_text(w, text, n);
+    put_fill(w, ' ', pad);
+  }
+  else if (zero)
+  {
+    put_text(w, sign, sign_len);
+    put_fill(w, '0', pad);
+    put_text(w, text, n);
+  }
+  else
+  {
+    put_fill(w, ' ', pad);
+    put_text(w, sign, sign_len);
+    put_text(w, text, n);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t to_decimal(char *end, unsigned long long value)
+{
+  /* Write digits backwards from the end of a buffer, two at a time */
+  static const char pairs[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+  char *p = end;
+
+  while (value >= 100)
+  {
+    unsigned int const i = (unsigned int)(value % 100) * 2;
+    value /= 100;
+    *--p = pairs[i + 1];
+    *--p = pairs[i];
+  }
+
+  if (value >= 10)
+  {
+    unsigned int const i = (unsigned int)value * 2;
+    *--p = pairs[i + 1];
+    *--p = pairs[i];
+  }
+  else
+  {
+    *--p = (char)('0' + value);
+  }
+
+  return (size_t)(end - p);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t to_hex(char *end, unsigned long long value, bool upper)
+{
+  const char *const digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char *p = end;
+
+  do
+  {
+    *--p = digits[value & 0xf];
+    value >>= 4;
+  }
+  while (value != 0);
+
+  return (size_t)(end - p);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+int debug_fmt_vsnprintf(_Optional char *buffer, size_t size,
+                        const char *format, va_list arg)
+{
+  assert(buffer != NULL || size == 0);
+  assert(format != NULL);
+
+  FmtWriter w = {buffer != NULL ? &*buffer : NULL, size, 0};
+  const char *f = format;
+  va_list copy;
+
+  /* Keep the arguments in case they must be formatted again */
+  va_copy(copy, arg);
+
+  for (;;)
+  {
+    /* Copy text up to the next conversion specification. Runs of text are
+       usually too short to be worth calling strchr and memcpy. */
+    for (; *f != '%' && *f != '\0'; ++f)
+    {
+      if (w.len < w.size)
+        w.buffer[w.len] = *f;
+
+      ++w.len;
+    }
+
+    if (*f == '\0')
+      break;
+
+    ++f;
+
+    bool left = false, zero = false;
+    for (;; ++f)
+    {
+      if (*f == '-')
+        left = true;
+      else if (*f == '0')
+        zero = true;
+      else
+        break;
+    }
+
+    size_t width = 0;
+    while (*f >= '0' && *f <= '9' && width <= MaxWidth)
+      width = width * 10 + (size_t)(*f++ - '0');
+
+    bool has_precision = false;
+    size_t precision = 0;
+    if (*f == '.')
+    {
+      has_precision = true;
+      ++f;
+      while (*f >= '0' && *f <= '9' && precision <= INT_MAX / 10)
+        precision = precision * 10 + (size_t)(*f++ - '0');
+    }
+
+    int longs = 0;
+    bool size_type = false;
+    if (*f == 'z')
+    {
+      size_type = true;
+      ++f;
+    }
+    else
+    {
+      while (*f == 'l' && longs < 2)
+      {
+        ++longs;
+        ++f;
+      }
+    }
+
+    bool const supported = width <= MaxWidth &&
+      (!has_precision || *f == 's') &&
+      (!size_type || *f == 'u' || *f == 'x' || *f == 'X') &&
+      (longs == 0 || (*f != 'c' && *f != 's' && *f != '%' && *f != 'p')) &&
+      (!zero || *f != 'p');
+
+    char digits[24];
+    char *const end = digits + sizeof(digits);
+
+    switch (supported ? *f : '\0')
+    {
+      case 'd':
+      case 'i':
+      {
+        long long const value = longs == 2 ? va_arg(arg, long long) :
+                                longs == 1 ? va_arg(arg, long) :
+                                va_arg(arg, int);
+        unsigned long long const mag = value < 0 ?
+          0ull - (unsigned long long)value : (unsigned long long)value;
+        size_t const n = to_decimal(end, mag);
+        put_field(&w, "-", value < 0 ? 1 : 0, end - n, n, width, left, zero);
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      {
+        unsigned long long const value =
+          size_type ? va_arg(arg, size_t) :
+          longs == 2 ? va_arg(arg, unsigned long long) :
+          longs == 1 ? va_arg(arg, unsigned long) :
+          va_arg(arg, unsigned int);
+        size_t const n = *f == 'u' ? to_decimal(end, value) :
+                                     to_hex(end, value, *f == 'X');
+        put_field(&w, "", 0, end - n, n, width, left, zero);
+        break;
+      }
+      case 's':
+      {
+        const char *s = va_arg(arg, const char *);
+        if (s == NULL)
+          s = "(null)";
+
+        size_t n;
+        if (has_precision)
+        {
+          const char *const nul = memchr(s, '\0', precision);
+          n = nul != NULL ? (size_t)(nul - s) : precision;
+        }
+        else
+        {
+          n = strlen(s);
+        }
+        put_field(&w, "", 0, s, n, width, left, false);
+        break;
+      }
+#ifdef FORMAT_POINTERS
+      case 'p':
+      {
+        const void *const p = va_arg(arg, void *);
+        if (p == NULL)
+        {
+          put_field(&w, "", 0, "(nil)", 5, width, left, false);
+        }
+        else
+        {
+          size_t const n = to_hex(end, (uintptr_t)p, false);
+          put_field(&w, "0x", 2, end - n, n, width, left, false);
+        }
+        break;
+      }
+#endif
+      case 'c':
+      {
+        char const c = (char)va_arg(arg, int);
+        put_field(&w, "", 0, &c, 1, width, left, false);
+        break;
+      }
+      case '%':
+      {
+        put_text(&w, "%", 1);
+        break;
+      }
+      default:
+      {
+        /* Let the C library handle anything else */
+        int const nout = vsnprintf(buffer != NULL ? &*buffer : NULL, size,
+                                   format, copy);
+        va_end(copy);
+        return nout;
+      }
+    }
+    ++f;
+  }
+
+  va_end(copy);
+
+  if (size > 0)
+  {
+    w.buffer[LOWEST(w.len, size - 1)] = '\0';
+  }
+  return w.len > INT_MAX ? -1 : (int)w.len;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int debug_fmt_vfprintf(FILE *stream, const char *format, va_list arg,
+                       bool newline)
+{
+  assert(stream != NULL);
+  assert(format != NULL);
+
+  /* Format the text (and line feed) so that it can be written at once */
+  char local[LocalSize];
+  va_list copy;
+
+  va_copy(copy, arg);
+  int nout = debug_fmt_vsnprintf(local, sizeof(local) - 1, format, arg);
+
+  if (nout >= 0 && (size_t)nout < sizeof(local) - 1)
+  {
+    if (newline)
+      local[nout++] = '\n';
+
+    nout = (int)fwrite(local, 1, (size_t)nout, stream);
+  }
+  else
+  {
+    nout = vfprintf(stream, format, copy);
+    if (newline && nout >= 0 && fputc('\n', stream) != EOF)
+      ++nout;
+  }
+
+  va_end(copy);
+  return nout;
+}
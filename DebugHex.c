@@ -0,0 +1,150 @@
+/*
+ * CBDebugLib: Hexadecimal dumps of binary data
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+
+/* Each row has the same layout as the output of 'hexdump -C', e.g.
+   "00000010  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 00 00  |Hello, w..."
+   Eight bytes at a time are converted to hexadecimal digits using integer
+   arithmetic on all of them at once, so that no table lookups or branches
+   are needed for each byte of data. */
+enum
+{
+  RowBytes = 16,
+  LaneBytes = 8,
+  OffsetDigits = 8,
+  HexStart = OffsetDigits + 2,
+  TextStart = HexStart + (RowBytes * 3) + 2,
+  RowSize = TextStart + RowBytes + 2 /* "|...|" */
+};
+
+#define LANES(byte) (UINT64_C(0x0101010101010101) * (byte))
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static uint64_t to_digits(uint64_t nibbles)
+{
+  /* Convert eight values in the range 0-15 to "0"-"9" or "a"-"f" */
+  uint64_t const letters = ((nibbles + LANES(6)) >> 4) & LANES(1);
+  return nibbles + LANES('0') + letters * ('a' - '0' - 10);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void format_lane(char *out, const unsigned char *bytes)
+{
+  /* Write eight bytes as "hh hh hh hh hh hh hh hh " */
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+
+  char high[LaneBytes], low[LaneBytes];
+  uint64_t const high_digits = to_digits((word >> 4) & LANES(0x0f));
+  uint64_t const low_digits = to_digits(word & LANES(0x0f));
+  memcpy(high, &high_digits, sizeof(high));
+  memcpy(low, &low_digits, sizeof(low));
+
+  for (size_t i = 0; i < LaneBytes; ++i)
+  {
+    out[i * 3] = high[i];
+    out[i * 3 + 1] = low[i];
+    out[i * 3 + 2] = ' ';
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void format_row(char *row, size_t offset, const unsigned char *bytes,
+                       size_t n)
+{
+  assert(n > 0);
+  assert(n <= RowBytes);
+
+  /* A short row is padded with zeros to be converted, then blanked */
+  unsigned char padded[RowBytes];
+  if (n < RowBytes)
+  {
+    memset(padded, 0, sizeof(padded));
+    memcpy(padded, bytes, n);
+    bytes = padded;
+  }
+
+  for (size_t i = 0; i < OffsetDigits; ++i)
+  {
+    row[i] = "0123456789abcdef"[(offset >> (4 * (OffsetDigits - 1 - i))) & 0xf];
+  }
+  row[OffsetDigits] = ' ';
+  row[OffsetDigits + 1] = ' ';
+
+  format_lane(row + HexStart, bytes);
+  row[HexStart + LaneBytes * 3] = ' ';
+  format_lane(row + HexStart + LaneBytes * 3 + 1, bytes + LaneBytes);
+
+  for (size_t i = n; i < RowBytes; ++i)
+  {
+    size_t const pos = HexStart + i * 3 + (i >= LaneBytes ? 1 : 0);
+    row[pos] = ' ';
+    row[pos + 1] = ' ';
+  }
+
+  row[TextStart - 1] = ' ';
+  row[TextStart] = '|';
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    unsigned char const c = bytes[i];
+    row[TextStart + 1 + i] = (c >= ' ' && c < 0x7f) ? (char)c : '.';
+  }
+  row[TextStart + 1 + n] = '|';
+
+  row[TextStart + 2 + n] = '\0';
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_hexdump(DebugCategory category, DebugLevel level,
+                   const void *data, size_t len)
+{
+  assert(category < DebugCategory_LAST);
+  assert(level < DebugLevel_LAST);
+  assert(data != NULL || len == 0);
+
+  const unsigned char *const bytes = data;
+
+  for (size_t offset = 0; offset < len; offset += RowBytes)
+  {
+    char row[RowSize + 1];
+    format_row(row, offset, bytes + offset,
+               LOWEST(len - offset, (size_t)RowBytes));
+    debug_log_printfl(category, level, "%s", row);
+  }
+}
@@ -0,0 +1,227 @@
+/*
+ * CBDebugLib: Formatting of structured debugging records as JSON
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+
+/* Each record is formatted as one JSON object, with the event name as the
+   value of the "event" member followed by the key/value pairs in order.
+   Like snprintf, formatting continues after the buffer is full so that the
+   caller can find out how much space is needed. */
+typedef struct
+{
+  char  *buffer;
+  size_t size;
+  size_t len; /* number of characters that would have been written */
+}
+JsonWriter;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void put_text(JsonWriter *w, const char *text, size_t n)
+{
+  if (w->len < w->size)
+  {
+    size_t const room = w->size - w->len;
+    memcpy(w->buffer + w->len, text, LOWEST(n, room));
+  }
+  w->len += n;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_format(JsonWriter *w, const char *format, ...)
+{
+  char tmp[64];
+  va_list ap;
+
+  va_start(ap, format);
+  int const nout = vsnprintf(tmp, sizeof(tmp), format, ap);
+  va_end(ap);
+
+  if (nout > 0)
+  {
+    put_text(w, tmp, LOWEST((size_t)nout, sizeof(tmp) - 1));
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_chars(JsonWriter *w, const char *s, size_t len)
+{
+  put_text(w, "\"", 1);
+
+  for (const char *const end = s + len;;)
+  {
+    /* Copy runs of characters that needn't be escaped */
+    size_t n = 0;
+    while (s + n < end && s[n] != '"' && s[n] != '\\' &&
+           (unsigned char)s[n] >= ' ')
+    {
+      ++n;
+    }
+    put_text(w, s, n);
+    s += n;
+
+    if (s == end)
+      break;
+
+    if (*s == '"' || *s == '\\')
+    {
+      char const esc[2] = {'\\', *s};
+      put_text(w, esc, sizeof(esc));
+    }
+    else
+    {
+      put_format(w, "\\u%04x", (unsigned int)(unsigned char)*s);
+    }
+    ++s;
+  }
+
+  put_text(w, "\"", 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_string(JsonWriter *w, const char *s)
+{
+  put_chars(w, s, strlen(s));
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t finish(JsonWriter *w)
+{
+  if (w->size > 0)
+  {
+    w->buffer[LOWEST(w->len, w->size - 1)] = '\0';
+  }
+  return w->len;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void put_value(JsonWriter *w, const DebugKV *kv)
+{
+  switch (kv->type)
+  {
+    case DebugKVType_Int:
+      put_format(w, "%lld", kv->value.i);
+      break;
+
+    case DebugKVType_UInt:
+      put_format(w, "%llu", kv->value.u);
+      break;
+
+    case DebugKVType_Bool:
+      if (kv->value.b)
+        put_text(w, "true", 4);
+      else
+        put_text(w, "false", 5);
+      break;
+
+    case DebugKVType_Double:
+      /* JSON has no representation of infinity or NaN */
+      if (isfinite(kv->value.d))
+        put_format(w, "%.17g", kv->value.d);
+      else
+        put_text(w, "null", 4);
+      break;
+
+    case DebugKVType_Ptr:
+      put_format(w, "\"%p\"", kv->value.p);
+      break;
+
+    case DebugKVType_Str:
+      if (kv->value.s != NULL)
+        put_string(w, kv->value.s);
+      else
+        put_text(w, "null", 4);
+      break;
+
+    case DebugKVType_Site:
+    {
+      DebugSiteInfo info;
+      if (debug_site_info(kv->value.site, &info))
+        put_string(w, info.location);
+      else
+        put_text(w, "null", 4);
+      break;
+    }
+
+    default:
+      put_text(w, "null", 4);
+      break;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+size_t debug_kv_format(char *buffer, size_t size, const char *event,
+                       const DebugKV *pairs, size_t count)
+{
+  assert(buffer != NULL || size == 0);
+  assert(event != NULL);
+  assert(pairs != NULL || count == 0);
+
+  JsonWriter w = {buffer, size, 0};
+
+  put_text(&w, "{\"event\":", 9);
+  put_string(&w, event);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    put_text(&w, ",", 1);
+    put_string(&w, pairs[i].key);
+    put_text(&w, ":", 1);
+    put_value(&w, &pairs[i]);
+  }
+
+  put_text(&w, "}", 1);
+  return finish(&w);
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_kv_quote(char *buffer, size_t size, const char *text,
+                      size_t len)
+{
+  assert(buffer != NULL || size == 0);
+  assert(text != NULL || len == 0);
+
+  JsonWriter w = {buffer, size, 0};
+  put_chars(&w, text, len);
+  return finish(&w);
+}
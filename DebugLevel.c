@@ -0,0 +1,204 @@
+/*
+ * CBDebugLib: Run-time selection of debugging output by category and level
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Added DebugLevel_Data, which is disabled by default.
+                  Added debug_get_category_name.
+*/
+
+/* ISO library headers */
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+
+/* Bit mask of all levels from DebugLevel_Error up to and including 'level' */
+#define LEVEL_MASK(level) ((2u << (level)) - 2u)
+
+/* Structured records must be enabled explicitly */
+#define DEFAULT_LEVELS LEVEL_MASK(DebugLevel_Verbose)
+
+#define DEFAULT_LEVELS_8 DEFAULT_LEVELS, DEFAULT_LEVELS, DEFAULT_LEVELS, \
+                         DEFAULT_LEVELS, DEFAULT_LEVELS, DEFAULT_LEVELS, \
+                         DEFAULT_LEVELS, DEFAULT_LEVELS
+
+unsigned int debug_levels[DebugCategory_LAST] =
+{
+  DEFAULT_LEVELS_8, DEFAULT_LEVELS_8, DEFAULT_LEVELS_8, DEFAULT_LEVELS_8
+};
+
+static _Optional const char *category_names[DebugCategory_LAST] =
+{
+  [DebugCategory_Default] = "Default",
+  [DebugCategory_PseudoEvnt] = "PseudoEvnt",
+  [DebugCategory_PseudoExit] = "PseudoExit",
+  [DebugCategory_PseudoFlex] = "PseudoFlex",
+  [DebugCategory_PseudoIO] = "PseudoIO",
+  [DebugCategory_PseudoKern] = "PseudoKern",
+  [DebugCategory_PseudoTbox] = "PseudoTbox",
+  [DebugCategory_PseudoWimp] = "PseudoWimp",
+};
+
+static const char *const level_names[DebugLevel_LAST] =
+{
+  [DebugLevel_None] = "off",
+  [DebugLevel_Error] = "error",
+  [DebugLevel_Warning] = "warning",
+  [DebugLevel_Info] = "info",
+  [DebugLevel_Verbose] = "verbose",
+  [DebugLevel_Data] = "data",
+};
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static bool name_matches(const char *name, const char *s, size_t len)
+{
+  /* Compare a name with a substring, ignoring case */
+  size_t i;
+  for (i = 0; i < len; ++i)
+  {
+    if (name[i] == '\0' ||
+        tolower((unsigned char)name[i]) != tolower((unsigned char)s[i]))
+    {
+      return false;
+    }
+  }
+  return name[i] == '\0';
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool find_level(const char *s, size_t len, DebugLevel *level)
+{
+  for (size_t i = 0; i < ARRAY_SIZE(level_names); ++i)
+  {
+    if (name_matches(level_names[i], s, len))
+    {
+      *level = (DebugLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool find_category(const char *s, size_t len, DebugCategory *category)
+{
+  for (size_t i = 0; i < ARRAY_SIZE(category_names); ++i)
+  {
+    _Optional const char *const name = category_names[i];
+    if (name != NULL && name_matches(&*name, s, len))
+    {
+      *category = (DebugCategory)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_set_level(DebugCategory category, DebugLevel level)
+{
+  assert(category < DebugCategory_LAST);
+  assert(level < DebugLevel_LAST);
+
+  debug_levels[category] = LEVEL_MASK(level);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_set_category_name(DebugCategory category, const char *name)
+{
+  assert(category >= DebugCategory_User);
+  assert(category < DebugCategory_LAST);
+  assert(name != NULL);
+
+  category_names[category] = name;
+}
+
+/* ----------------------------------------------------------------------- */
+
+const char *debug_get_category_name(DebugCategory category)
+{
+  assert(category < DebugCategory_LAST);
+
+  _Optional const char *const name = category_names[category];
+  return name != NULL ? &*name : NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_set_levels(const char *spec)
+{
+  assert(spec != NULL);
+
+  /* Apply the items to a copy so that nothing changes if one is bad */
+  unsigned int levels[DebugCategory_LAST];
+  memcpy(levels, debug_levels, sizeof(levels));
+
+  for (const char *item = spec; *item != '\0'; )
+  {
+    const char *const end = item + strcspn(item, ",");
+    _Optional const char *const equals = memchr(item, '=', end - item);
+    DebugLevel level;
+
+    if (equals == NULL)
+    {
+      /* A level name alone applies to all categories */
+      if (!find_level(item, end - item, &level))
+        return false;
+
+      for (size_t i = 0; i < ARRAY_SIZE(levels); ++i)
+        levels[i] = LEVEL_MASK(level);
+    }
+    else
+    {
+      if (!find_level(&*equals + 1, end - (&*equals + 1), &level))
+        return false;
+
+      if (&*equals - item == 1 && *item == '*')
+      {
+        for (size_t i = 0; i < ARRAY_SIZE(levels); ++i)
+          levels[i] = LEVEL_MASK(level);
+      }
+      else
+      {
+        DebugCategory category;
+        if (!find_category(item, &*equals - item, &category))
+          return false;
+
+        levels[category] = LEVEL_MASK(level);
+      }
+    }
+
+    item = (*end == ',') ? end + 1 : end;
+  }
+
+  memcpy(debug_levels, levels, sizeof(levels));
+  return true;
+}
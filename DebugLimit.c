@@ -0,0 +1,312 @@
+/*
+ * CBDebugLib: Suppression of repeated and excessive debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Repeated lines are detected by comparing a hash of the
+                  whole text instead of only its first 256 characters.
+                  debug_limit_flush can be called without waiting for the
+                  lock.
+*/
+
+/* Needed for clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* Call sites are identified by the address of their format string. Only
+   messages that end a line are eligible for suppression, so that a line
+   built by several calls is never broken up. Lines are compared by length
+   and a hash of their text, which is formatted on the stack unless it is
+   too long. */
+enum
+{
+  SiteTableSize = 256, /* must be a power of two */
+  TextBufferSize = 256,
+  TokenScale = 1000    /* tokens are counted in thousandths */
+};
+
+typedef struct
+{
+  const char    *format;
+  unsigned long  tokens;     /* in thousandths of a message */
+  unsigned long  last_ms;    /* time at which tokens were last added */
+  unsigned long  suppressed; /* messages discarded since last output */
+}
+LimitSite;
+
+static DebugMutex limit_lock = DEBUG_MUTEX_INIT;
+static bool suppress_repeats;
+static unsigned int rate_per_second; /* 0 means unlimited */
+static unsigned int rate_burst;
+
+/* The last message output, to detect repetition */
+static const char *last_format;
+static unsigned long last_hash;
+static size_t last_len;
+static unsigned long repeats;
+
+static LimitSite sites[SiteTableSize];
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static unsigned long clock_ms(void)
+{
+#ifdef CBDEBUG_POSIX
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long)ts.tv_sec * 1000ul +
+         (unsigned long)ts.tv_nsec / 1000000ul;
+#else
+  return (unsigned long)((double)clock() * (1000.0 / CLOCKS_PER_SEC));
+#endif
+}
+
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned long hash_text(const char *text, size_t len)
+{
+  /* FNV-1a, truncated to 32 bits so that the result is the same size on
+     all platforms */
+  unsigned long hash = 2166136261ul;
+
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (unsigned char)text[i];
+    hash = (hash * 16777619ul) & 0xfffffffful;
+  }
+  return hash;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional LimitSite *find_site(const char *format)
+{
+  size_t const mask = SiteTableSize - 1;
+  size_t i = ((size_t)format >> 3) & mask;
+
+  for (size_t n = 0; n < SiteTableSize; ++n, i = (i + 1) & mask)
+  {
+    LimitSite *const site = &sites[i];
+    if (site->format == format)
+      return site;
+
+    if (site->format == NULL)
+    {
+      /* New site, with a full bucket of tokens */
+      site->format = format;
+      site->tokens = (unsigned long)rate_burst * TokenScale;
+      site->last_ms = clock_ms();
+      site->suppressed = 0;
+      return site;
+    }
+  }
+
+  return NULL; /* table is full, so don't limit this site */
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool take_token(LimitSite *site)
+{
+  unsigned long const now = clock_ms();
+  unsigned long const elapsed = now - site->last_ms;
+  unsigned long const max = (unsigned long)rate_burst * TokenScale;
+
+  /* Refill the bucket at the configured rate */
+  if (elapsed > 0)
+  {
+    unsigned long const room = max - site->tokens;
+    if (elapsed >= room / rate_per_second)
+      site->tokens = max;
+    else
+      site->tokens += elapsed * rate_per_second;
+
+    site->last_ms = now;
+  }
+
+  if (site->tokens < TokenScale)
+    return false;
+
+  site->tokens -= TokenScale;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_set_repeat_suppression(bool enable)
+{
+  debug_mutex_lock(&limit_lock);
+  suppress_repeats = enable;
+  last_format = NULL;
+  debug_mutex_unlock(&limit_lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_set_rate_limit(unsigned int per_second, unsigned int burst)
+{
+  debug_mutex_lock(&limit_lock);
+  rate_per_second = per_second;
+  rate_burst = burst > 0 ? burst : 1;
+  memset(sites, 0, sizeof(sites));
+  debug_mutex_unlock(&limit_lock);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_limit_check(const char *format, va_list arg, bool newline,
+                       unsigned long *repeated, unsigned long *suppressed)
+{
+  assert(format != NULL);
+  assert(repeated != NULL);
+  assert(suppressed != NULL);
+
+  *repeated = *suppressed = 0;
+
+  /* Cheap test for the common case, without taking the lock */
+  if (!suppress_repeats && rate_per_second == 0)
+    return true;
+
+  char text[TextBufferSize];
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(text, sizeof(text), format, copy);
+  va_end(copy);
+  if (nout < 0)
+    return true;
+
+  size_t const len = (size_t)nout;
+  unsigned long hash;
+  char last_char = '\0';
+
+  if (len < sizeof(text))
+  {
+    hash = hash_text(text, len);
+    if (len > 0)
+      last_char = text[len - 1];
+  }
+  else
+  {
+    /* Format the whole text again, so that long lines which differ only
+       near the end aren't mistaken for repeats */
+    _Optional char *const long_text = malloc(len + 1);
+    if (long_text == NULL)
+      return true;
+
+    if (debug_fmt_vsnprintf(&*long_text, len + 1, format, arg) != nout)
+    {
+      free(long_text);
+      return true;
+    }
+    hash = hash_text(&*long_text, len);
+    last_char = long_text[len - 1];
+    free(long_text);
+  }
+
+  bool const ends_line = newline || last_char == '\n';
+  bool allow = true;
+
+  debug_mutex_lock(&limit_lock);
+
+  if (suppress_repeats && ends_line && last_format == format &&
+      last_len == len && last_hash == hash)
+  {
+    /* Same text from the same call site as the previous line */
+    repeats++;
+    allow = false;
+  }
+  else if (ends_line && rate_per_second > 0)
+  {
+    _Optional LimitSite *const site = find_site(format);
+    if (site != NULL)
+    {
+      if (take_token(&*site))
+      {
+        *suppressed = site->suppressed;
+        site->suppressed = 0;
+      }
+      else
+      {
+        site->suppressed++;
+        allow = false;
+      }
+    }
+  }
+
+  if (allow)
+  {
+    /* Any run of repeated lines has ended */
+    *repeated = repeats;
+    repeats = 0;
+
+    if (ends_line)
+    {
+      last_format = format;
+      last_hash = hash;
+      last_len = len;
+    }
+    else
+    {
+      last_format = NULL;
+    }
+  }
+
+  debug_mutex_unlock(&limit_lock);
+  return allow;
+}
+
+/* ----------------------------------------------------------------------- */
+
+unsigned long debug_limit_flush(bool wait)
+{
+  if (!wait)
+  {
+    /* Don't deadlock if the lock was held by a thread that aborted */
+    if (!debug_mutex_trylock(&limit_lock))
+      return 0;
+  }
+  else
+  {
+    debug_mutex_lock(&limit_lock);
+  }
+
+  unsigned long const n = repeats;
+  repeats = 0;
+  last_format = NULL;
+  debug_mutex_unlock(&limit_lock);
+  return n;
+}
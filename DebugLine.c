@@ -0,0 +1,247 @@
+/*
+ * CBDebugLib: Assembly of debugging output into whole lines
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* Text is accumulated in a buffer belonging to the calling thread until a
+   line feed is output, so that partial lines output by different threads
+   are never mixed. Buffers grow as needed and are freed when their thread
+   exits. */
+enum
+{
+  LineSizeMin = 256
+};
+
+#define BAD_STRING "BAD"
+
+typedef struct
+{
+  _Optional char *data;
+  size_t          len;  /* number of characters accumulated */
+  size_t          size; /* capacity, including a string terminator */
+}
+LineBuffer;
+
+static THREAD_LOCAL LineBuffer thread_line;
+
+/* The sink registered by the client program */
+static _Optional DebugLineSink *client_sink;
+static void *client_arg;
+
+#ifdef CBDEBUG_POSIX
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t line_key;
+#endif
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+#ifdef CBDEBUG_POSIX
+static void free_line(void *arg)
+{
+  /* Called when a thread exits, discarding any incomplete line */
+  free(arg);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void make_key(void)
+{
+  (void)pthread_key_create(&line_key, free_line);
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+static bool reserve(LineBuffer *line, size_t extra)
+{
+  /* Ensure that there is room for 'extra' more characters and a string
+     terminator */
+  if (line->data != NULL && line->size - line->len > extra)
+    return true;
+
+  size_t new_size = line->size > 0 ? line->size : LineSizeMin;
+  while (new_size - line->len <= extra)
+  {
+    if (new_size > (size_t)-1 / 2)
+      return false;
+
+    new_size *= 2;
+  }
+
+  _Optional char *const new_data = realloc(line->data, new_size);
+  if (new_data == NULL)
+    return false;
+
+  line->data = new_data;
+  line->size = new_size;
+#ifdef CBDEBUG_POSIX
+  (void)pthread_once(&key_once, make_key);
+  (void)pthread_setspecific(line_key, &*new_data);
+#endif
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void output_lines(LineBuffer *line, size_t start,
+                         _Optional DebugLineSink *sink)
+{
+  /* Pass each complete line to the sink, starting the search for line
+     feeds from 'start' because no earlier text can contain one */
+  assert(line->data != NULL);
+  char *const data = &*line->data;
+
+  if (sink == NULL)
+  {
+    sink = client_sink;
+  }
+
+  size_t done = 0;
+  for (;;)
+  {
+    _Optional char *const eol = memchr(data + start, '\n', line->len - start);
+    if (eol == NULL)
+      break;
+
+    size_t const end = (size_t)(&*eol - data);
+    data[end] = '\0';
+    if (sink != NULL)
+    {
+      sink(data + done, end - done, client_arg);
+    }
+
+    done = start = end + 1;
+  }
+
+  /* Keep the start of the next line */
+  line->len -= done;
+  memmove(data, data + done, line->len);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_set_line_sink(DebugLineSink *sink, void *arg)
+{
+  assert(sink != NULL);
+  client_sink = sink;
+  client_arg = arg;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_line_vprintf(_Optional DebugLineSink *sink, const char *format,
+                        va_list arg, bool newline)
+{
+  LineBuffer *const line = &thread_line;
+  size_t const start = line->len;
+  va_list copy;
+
+  va_copy(copy, arg);
+
+  /* Try to format the text into the space already available */
+  size_t const avail = line->data != NULL ? line->size - line->len : 0;
+  int nout = avail > 0 ?
+             debug_fmt_vsnprintf(&*line->data + line->len, avail, format,
+                                 arg) :
+             debug_fmt_vsnprintf(NULL, 0, format, arg);
+
+  if (nout < 0)
+  {
+    if (reserve(line, sizeof(BAD_STRING) - 1))
+    {
+      strcpy(&*line->data + line->len, BAD_STRING);
+      line->len += sizeof(BAD_STRING) - 1;
+    }
+  }
+  else if ((size_t)nout < avail)
+  {
+    line->len += (size_t)nout;
+  }
+  else if (reserve(line, (size_t)nout))
+  {
+    /* Format the text again now that there is enough space */
+    (void)debug_fmt_vsnprintf(&*line->data + line->len, (size_t)nout + 1,
+                              format, copy);
+    line->len += (size_t)nout;
+  }
+  else if (avail > 0)
+  {
+    /* Keep as much of the text as fitted */
+    line->len = line->size - 1;
+  }
+
+  va_end(copy);
+
+  if (newline && reserve(line, 1))
+  {
+    (&*line->data)[line->len++] = '\n';
+  }
+
+  if (line->len > start)
+  {
+    output_lines(line, start, sink);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_line_write(_Optional DebugLineSink *sink, const char *text,
+                      size_t len)
+{
+  assert(text != NULL);
+
+  LineBuffer *const line = &thread_line;
+  size_t const start = line->len;
+
+  if (!reserve(line, len))
+  {
+    /* Keep as much of the text as will fit */
+    if (line->data == NULL)
+      return;
+
+    len = line->size - 1 - line->len;
+  }
+
+  memcpy(&*line->data + line->len, text, len);
+  line->len += len;
+
+  if (line->len > start)
+  {
+    output_lines(line, start, sink);
+  }
+}
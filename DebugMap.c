@@ -0,0 +1,296 @@
+/*
+ * CBDebugLib: Debugging output to a memory-mapped log file
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for ftruncate, pread and O_CLOEXEC in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/* The log file is mapped in fixed-size chunks, each of which is mapped the
+   first time that text is written to it and remains mapped until the file
+   is closed. Callers reserve space by atomically advancing a cursor, so
+   most writes need only a memcpy. The file is extended a chunk at a time
+   and truncated to the length of the text when closed. If the program
+   terminates before then, the text remains in the page cache (followed by
+   null bytes), to be written to the file by the operating system. */
+enum
+{
+  ChunkSize = 4 * 1024 * 1024, /* a multiple of any likely page size */
+  MaxChunks = 1024,            /* text beyond 4 GB is discarded */
+  FormatBufferSize = 512,
+  ScanBlockSize = 4096
+};
+
+static int fd = -1;
+static volatile size_t active;
+static volatile size_t cursor; /* offset at which to write the next text */
+static void *volatile chunks[MaxChunks];
+static DebugMutex map_lock = DEBUG_MUTEX_INIT;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static size_t find_end(void)
+{
+  /* Find the end of the text in an existing file, ignoring any null bytes
+     left at the end of the last chunk by a program that didn't close it */
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    return 0;
+
+  size_t end = (size_t)st.st_size;
+  char block[ScanBlockSize];
+
+  while (end > 0)
+  {
+    size_t const n = LOWEST(end, sizeof(block));
+    if (pread(fd, block, n, (off_t)(end - n)) != (ssize_t)n)
+      break;
+
+    size_t i = n;
+    while (i > 0 && block[i - 1] == '\0')
+      --i;
+
+    end -= n - i;
+    if (i > 0)
+      break;
+  }
+
+  return end;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional char *get_chunk(size_t index)
+{
+  void *chunk = sync_load_ptr(&chunks[index]);
+  if (chunk != NULL)
+    return chunk;
+
+  /* Map the chunk unless another thread did so first */
+  debug_mutex_lock(&map_lock);
+
+  chunk = chunks[index];
+  if (chunk == NULL)
+  {
+    off_t const start = (off_t)index * ChunkSize;
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 &&
+        (st.st_size >= start + ChunkSize ||
+         ftruncate(fd, start + ChunkSize) == 0))
+    {
+      void *const p = mmap(NULL, ChunkSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, start);
+      if (p != MAP_FAILED)
+      {
+        (void)sync_cas_ptr(&chunks[index], NULL, p);
+        chunk = p;
+      }
+    }
+  }
+
+  debug_mutex_unlock(&map_lock);
+  return chunk;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_text(const char *text, size_t len)
+{
+  size_t offset = sync_fetch_add(&cursor, len);
+
+  while (len > 0)
+  {
+    size_t const index = offset / ChunkSize;
+    if (index >= MaxChunks)
+      break;
+
+    _Optional char *const chunk = get_chunk(index);
+    if (chunk == NULL)
+      break;
+
+    /* Text can straddle the boundary between two chunks */
+    size_t const within = offset % ChunkSize;
+    size_t const n = LOWEST(len, ChunkSize - within);
+    memcpy(&*chunk + within, text, n);
+    text += n;
+    len -= n;
+    offset += n;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_map_open(const char *path)
+{
+  assert(path != NULL);
+  assert(!sync_load(&active));
+
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  if (fd < 0)
+    return false;
+
+  sync_store(&cursor, find_end());
+  sync_store(&active, 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_map_close(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  sync_store(&active, 0);
+
+  for (size_t i = 0; i < MaxChunks; ++i)
+  {
+    void *const chunk = chunks[i];
+    if (chunk != NULL)
+    {
+      (void)munmap(chunk, ChunkSize);
+      chunks[i] = NULL;
+    }
+  }
+
+  /* Remove the unused part of the last chunk */
+  size_t const end = LOWEST(sync_load(&cursor), (size_t)MaxChunks * ChunkSize);
+  (void)ftruncate(fd, (off_t)end);
+  (void)close(fd);
+  fd = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_map_write(const char *text, size_t len)
+{
+  if (!sync_load(&active))
+    return false;
+
+  write_text(text, len);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_map_vprintf(const char *format, va_list arg, bool newline)
+{
+  if (!sync_load(&active))
+    return false;
+
+  /* The length of the text must be known before space can be reserved for
+     it, so format it into a temporary buffer. Space is reserved for the
+     string terminator, which is overwritten by the line feed (if any). */
+  char local[FormatBufferSize];
+  va_list copy;
+  va_copy(copy, arg);
+  int const nout = debug_fmt_vsnprintf(local, sizeof(local), format, arg);
+
+  if (nout >= 0 && (size_t)nout < sizeof(local))
+  {
+    size_t len = (size_t)nout;
+    if (newline)
+      local[len++] = '\n';
+
+    write_text(local, len);
+  }
+  else if (nout >= 0)
+  {
+    size_t len = (size_t)nout;
+    _Optional char *const text = malloc(len + 1);
+    if (text != NULL)
+    {
+      char *const t = &*text;
+      (void)debug_fmt_vsnprintf(t, len + 1, format, copy);
+      if (newline)
+        t[len++] = '\n';
+
+      write_text(t, len);
+      free(text);
+    }
+  }
+
+  va_end(copy);
+  return true;
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_map_open(const char *path)
+{
+  NOT_USED(path);
+  return false; /* caller falls back to an ordinary file */
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_map_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_map_write(const char *text, size_t len)
+{
+  NOT_USED(text);
+  NOT_USED(len);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_map_vprintf(const char *format, va_list arg, bool newline)
+{
+  NOT_USED(format);
+  NOT_USED(arg);
+  NOT_USED(newline);
+  return false;
+}
+
+#endif /* CBDEBUG_POSIX */
@@ -0,0 +1,272 @@
+/*
+ * CBDebugLib: Flight recorder for recent debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  debug_abort commits any text written to a log file in
+                  DebugOutput_FlushedFile mode.
+                  Text formatted for output is copied to the recorder
+                  instead of being formatted a second time.
+                  The recorder can't be resized once text was recorded.
+                  debug_abort flushes all output streams.
+                  debug_abort outputs any pending count of repeated lines.
+                  debug_abort writes any text queued for asynchronous output.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* The recorder is a circular buffer holding the most recent debugging
+   output, whatever the output mode. Callers reserve space by atomically
+   advancing a cursor and then copy their text into it, so concurrent
+   callers never wait for one another. Text may be overwritten whilst it
+   is being dumped, but that is acceptable for diagnostic purposes.
+
+   Callers pass a copy of the text that they already formatted for output,
+   so the only cost is a copy. The buffer is only replaced before any text
+   has been recorded, since callers don't wait for one another. */
+enum
+{
+  RecorderSizeDefault = 16 * 1024,
+  RecorderSizeMin = 1024,
+  RecorderSizeMax = 1 << 30,
+  LineSizeMax = 256 /* longer text is truncated */
+};
+
+enum
+{
+  State_Idle,     /* nothing recorded yet */
+  State_Resizing, /* buffer being replaced */
+  State_InUse     /* text recorded, so the buffer can't be replaced */
+};
+
+static char default_buffer[RecorderSizeDefault];
+static char *buffer = default_buffer;
+static size_t buffer_size = RecorderSizeDefault; /* a power of two, or 0 */
+static volatile size_t state = State_Idle;
+static volatile size_t cursor; /* total number of characters recorded */
+static char dump_name[64] = "DebugDump";
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static bool start_recording(void)
+{
+  /* Prevent the buffer from being replaced from now on */
+  for (;;)
+  {
+    size_t const current = sync_load(&state);
+    if (current == State_InUse)
+      return true;
+
+    if (current == State_Resizing)
+      return false; /* lose the text rather than wait */
+
+    (void)sync_cas(&state, State_Idle, State_InUse);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void record_text(const char *text, size_t len)
+{
+  if (!start_recording())
+    return;
+
+  size_t const size = buffer_size;
+  if (size == 0)
+    return;
+
+  if (len > size)
+  {
+    /* Only the end of the text will survive */
+    text += len - size;
+    len = size;
+  }
+
+  size_t const offset = sync_fetch_add(&cursor, len) & (size - 1);
+  size_t const contig = LOWEST(len, size - offset);
+
+  memcpy(buffer + offset, text, contig);
+  memcpy(buffer, text + contig, len - contig);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+bool debug_set_recorder(size_t size, const char *name)
+{
+  assert(name != NULL);
+
+  /* Other threads may be copying text into the existing buffer */
+  if (!sync_cas(&state, State_Idle, State_Resizing))
+    return false;
+
+  STRCPY_SAFE(dump_name, name);
+
+  size_t new_size = 0;
+  if (size > 0)
+  {
+    new_size = RecorderSizeMin;
+    while (new_size < size && new_size < RecorderSizeMax)
+    {
+      new_size *= 2;
+    }
+  }
+
+  bool ok = true;
+  if (new_size != buffer_size)
+  {
+    char *new_buffer = default_buffer;
+    if (new_size > sizeof(default_buffer))
+    {
+      _Optional char *const p = malloc(new_size);
+      if (p == NULL)
+        ok = false; /* keep the existing buffer */
+      else
+        new_buffer = &*p;
+    }
+
+    if (ok)
+    {
+      if (buffer != default_buffer)
+        free(buffer);
+
+      buffer = new_buffer;
+      buffer_size = new_size;
+    }
+  }
+
+  sync_store(&state, State_Idle);
+  return ok;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_dump_recorder(void)
+{
+  size_t const size = buffer_size;
+  if (size == 0)
+    return false;
+
+  char file_path[256];
+  if (!debug_make_path(file_path, sizeof(file_path), dump_name))
+    return false;
+
+  _Optional FILE *const f = fopen(file_path, "w");
+  if (f == NULL)
+    return false;
+
+  size_t const end = sync_load(&cursor);
+  size_t len = LOWEST(end, size);
+  size_t offset = (end - len) & (size - 1);
+
+  if (end > size)
+  {
+    /* The oldest line was probably partially overwritten */
+    while (len > 0 && buffer[offset] != '\n')
+    {
+      offset = (offset + 1) & (size - 1);
+      --len;
+    }
+    if (len > 0)
+    {
+      offset = (offset + 1) & (size - 1);
+      --len;
+    }
+  }
+
+  size_t const contig = LOWEST(len, size - offset);
+  bool ok = fwrite(buffer + offset, 1, contig, &*f) == contig &&
+            fwrite(buffer, 1, len - contig, &*f) == len - contig;
+
+  if (fclose(&*f) != 0)
+    ok = false;
+
+  return ok;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_abort(void)
+{
+  static volatile size_t aborting;
+
+  /* Don't try to dump the recorder again if an assertion fails whilst
+     dumping it */
+  if (sync_cas(&aborting, 0, 1))
+  {
+    debug_flush_repeats();
+    (void)debug_dump_recorder();
+
+    /* Don't lose text buffered by DebugOutput_File, for example */
+    (void)fflush(NULL);
+    debug_async_abort();
+    debug_sync_commit();
+  }
+  abort();
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_rec_vprintf(const char *format, va_list arg, bool newline)
+{
+  if (!debug_rec_enabled())
+    return;
+
+  /* Space is reserved for the string terminator, which is overwritten by
+     the line feed (if any) */
+  char text[LineSizeMax + 1];
+  int const nout = debug_fmt_vsnprintf(text, sizeof(text), format, arg);
+  if (nout < 0)
+    return;
+
+  size_t len = LOWEST((size_t)nout, sizeof(text) - 1);
+  if (newline)
+    text[len++] = '\n';
+
+  record_text(text, len);
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_rec_enabled(void)
+{
+  return buffer_size > 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_rec_write(const char *text, size_t len)
+{
+  assert(text != NULL);
+  record_text(text, len);
+}
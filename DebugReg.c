@@ -0,0 +1,195 @@
+/*
+ * CBDebugLib: Registry of call sites identified by small integers
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebSys.h"
+
+/* Sites are numbered in order of registration, starting from 1, and never
+   removed. They are found through an open-addressing hash table keyed on
+   the text of the file name, the line number and the function name (if
+   any), so that the same site always gets the same identifier even if
+   its file name isn't always passed as the same pointer. Lookups don't
+   take the lock; it is only needed to register a new site, which is
+   published by storing its identifier in the table after the site has
+   been fully initialised. */
+enum
+{
+  TableSize = DEBUG_SITE_ID_MAX * 2 /* must be a power of two */
+};
+
+typedef struct
+{
+  const char    *file;
+  const char    *func;
+  unsigned long  line;
+  const char    *location; /* "file:line" */
+}
+SiteEntry;
+
+static DebugMutex lock = DEBUG_MUTEX_INIT;
+static SiteEntry entries[DEBUG_SITE_ID_MAX];
+static volatile size_t slots[TableSize]; /* site identifiers, or 0 */
+static volatile size_t count;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static size_t hash_site(const char *file, unsigned long line,
+                        const char *func)
+{
+  /* FNV-1a */
+  size_t hash = 2166136261u;
+
+  for (const char *s = file; *s != '\0'; ++s)
+    hash = (hash ^ (unsigned char)*s) * 16777619u;
+
+  hash = (hash ^ line) * 16777619u;
+
+  for (const char *s = func; *s != '\0'; ++s)
+    hash = (hash ^ (unsigned char)*s) * 16777619u;
+
+  return hash;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool same_string(const char *a, const char *b)
+{
+  return a == b || strcmp(a, b) == 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool find_slot(const char *file, unsigned long line, const char *func,
+                      size_t *slot, DebugSiteId *id)
+{
+  /* Find the slot holding the site or, failing that, the empty slot where
+     it would be added */
+  size_t i = hash_site(file, line, func) & (TableSize - 1);
+
+  for (size_t probes = 0; probes < TableSize; ++probes)
+  {
+    size_t const n = sync_load(&slots[i]);
+    if (n == 0)
+    {
+      *slot = i;
+      *id = 0;
+      return true;
+    }
+
+    const SiteEntry *const entry = &entries[n - 1];
+    if (entry->line == line && same_string(entry->file, file) &&
+        same_string(entry->func, func))
+    {
+      *slot = i;
+      *id = (DebugSiteId)n;
+      return true;
+    }
+
+    i = (i + 1) & (TableSize - 1);
+  }
+
+  return false; /* table is full */
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+DebugSiteId debug_site_intern(const char *file, unsigned long line,
+                              const char *func)
+{
+  assert(file != NULL);
+
+  const char *const fn = func != NULL ? func : "";
+  size_t slot;
+  DebugSiteId id;
+
+  if (!find_slot(file, line, fn, &slot, &id))
+    return 0;
+
+  if (id != 0)
+    return id;
+
+  debug_mutex_lock(&lock);
+
+  /* Another thread may have added the site since it was looked up */
+  if (find_slot(file, line, fn, &slot, &id) && id == 0)
+  {
+    size_t const n = sync_load(&count);
+    if (n < DEBUG_SITE_ID_MAX)
+    {
+      char buffer[32];
+      int const nout = snprintf(buffer, sizeof(buffer), ":%lu", line);
+      size_t const file_len = strlen(file);
+      _Optional char *const location = malloc(file_len + (size_t)nout + 1);
+      if (location != NULL && nout > 0)
+      {
+        memcpy(&*location, file, file_len);
+        strcpy(&*location + file_len, buffer);
+
+        SiteEntry *const entry = &entries[n];
+        entry->file = file;
+        entry->func = fn;
+        entry->line = line;
+        entry->location = &*location;
+
+        id = (DebugSiteId)(n + 1);
+        sync_store(&count, n + 1);
+        sync_store(&slots[slot], (size_t)id);
+      }
+      else
+      {
+        free(location);
+      }
+    }
+  }
+
+  debug_mutex_unlock(&lock);
+  return id;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_site_info(DebugSiteId id, DebugSiteInfo *info)
+{
+  assert(info != NULL);
+
+  if (id == 0 || id > sync_load(&count))
+    return false;
+
+  const SiteEntry *const entry = &entries[id - 1];
+  info->file = entry->file;
+  info->line = entry->line;
+  info->func = entry->func;
+  info->location = entry->location;
+  return true;
+}
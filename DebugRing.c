@@ -0,0 +1,367 @@
+/*
+ * CBDebugLib: Lock-free ring buffers for debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* Each record in a ring buffer consists of a header giving the length of
+   the text that follows it, padded to a multiple of the header size. A
+   record is never split across the end of the buffer: any space left over
+   is filled by a padding record. */
+typedef unsigned int RecordHeader;
+
+enum
+{
+  RingSizeMin = 1024,
+  RingSizeDefault = 64 * 1024,
+  RingSizeMax = 1 << 30
+};
+
+#define HEADER_SIZE sizeof(RecordHeader)
+#define PADDING_RECORD UINT_MAX
+
+/* The following structure is a single-producer, single-consumer queue.
+   Only the thread that owns it may advance 'head', and only code holding
+   the consumer lock may advance 'tail'. */
+typedef struct DebugRing
+{
+  struct DebugRing *next;  /* next ring in the list of all rings */
+  volatile size_t   owned; /* non-zero whilst owned by a thread */
+  volatile size_t   head;  /* total number of bytes produced */
+  volatile size_t   tail;  /* total number of bytes consumed */
+  volatile size_t   lost;  /* number of characters discarded */
+  size_t            size;  /* capacity in bytes (a power of two) */
+  char              data[];
+}
+DebugRing;
+
+typedef bool RecordCallback(const char *text, size_t len, void *arg);
+
+static void *volatile rings; /* rings are never freed */
+static THREAD_LOCAL DebugRing *thread_ring;
+static size_t ring_size = RingSizeDefault;
+static DebugMutex consumer_lock = DEBUG_MUTEX_INIT;
+
+#ifdef CBDEBUG_POSIX
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+#endif
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static size_t record_span(size_t len)
+{
+  /* Calculate the number of bytes occupied by a record of 'len' chars */
+  return HEADER_SIZE + ((len + HEADER_SIZE - 1) / HEADER_SIZE) * HEADER_SIZE;
+}
+
+/* ----------------------------------------------------------------------- */
+
+#ifdef CBDEBUG_POSIX
+static void release_ring(void *arg)
+{
+  /* Called when a thread exits, to allow its ring to be adopted by another
+     thread. Any pending text is retained until consumed. */
+  DebugRing *const ring = arg;
+  sync_store(&ring->owned, 0);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void make_key(void)
+{
+  (void)pthread_key_create(&ring_key, release_ring);
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional DebugRing *get_thread_ring(void)
+{
+  DebugRing *ring = thread_ring;
+  if (ring != NULL)
+    return ring;
+
+  /* Prefer to adopt a ring abandoned by a thread that has exited */
+  for (ring = sync_load_ptr(&rings); ring != NULL; ring = ring->next)
+  {
+    if (sync_cas(&ring->owned, 0, 1))
+      break;
+  }
+
+  if (ring == NULL)
+  {
+    size_t const size = ring_size;
+    _Optional DebugRing *const new_ring = malloc(sizeof(*new_ring) + size);
+    if (new_ring == NULL)
+      return NULL;
+
+    ring = &*new_ring;
+    ring->owned = 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->lost = 0;
+    ring->size = size;
+
+    /* Link the new ring at the head of the list of all rings */
+    do
+    {
+      ring->next = sync_load_ptr(&rings);
+    }
+    while (!sync_cas_ptr(&rings, ring->next, ring));
+  }
+
+  thread_ring = ring;
+#ifdef CBDEBUG_POSIX
+  (void)pthread_once(&key_once, make_key);
+  (void)pthread_setspecific(ring_key, ring);
+#endif
+  return ring;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t consume_records(RecordCallback *callback, void *arg)
+{
+  size_t total = 0;
+  bool stop = false;
+
+  debug_mutex_lock(&consumer_lock);
+
+  for (DebugRing *ring = sync_load_ptr(&rings);
+       ring != NULL && !stop;
+       ring = ring->next)
+  {
+    size_t const mask = ring->size - 1;
+    size_t const head = sync_load(&ring->head);
+    size_t tail = ring->tail;
+
+    while (tail != head)
+    {
+      size_t const offset = tail & mask;
+      RecordHeader len;
+      memcpy(&len, &ring->data[offset], HEADER_SIZE);
+
+      if (len == PADDING_RECORD)
+      {
+        /* Skip to the start of the buffer */
+        tail += ring->size - offset;
+        continue;
+      }
+
+      if (!callback(&ring->data[offset + HEADER_SIZE], len, arg))
+      {
+        stop = true;
+        break;
+      }
+
+      total += len;
+      tail += record_span(len);
+    }
+
+    /* Release the consumed space for reuse by the producer */
+    sync_store(&ring->tail, tail);
+  }
+
+  debug_mutex_unlock(&consumer_lock);
+
+  return total;
+}
+
+/* ----------------------------------------------------------------------- */
+
+typedef struct
+{
+  char   *buffer;
+  size_t  size;
+  size_t  copied;
+}
+PullState;
+
+static bool pull_record(const char *text, size_t len, void *arg)
+{
+  PullState *const state = arg;
+
+  if (len > state->size - state->copied)
+    return false; /* record won't fit */
+
+  memcpy(state->buffer + state->copied, text, len);
+  state->copied += len;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool flush_record(const char *text, size_t len, void *arg)
+{
+  DebugOutput const *const output_mode = arg;
+  debug_output_text(*output_mode, text, len);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_ring_set_size(size_t size)
+{
+  size_t new_size = RingSizeMin;
+
+  while (new_size < size && new_size < RingSizeMax)
+  {
+    new_size *= 2;
+  }
+
+  ring_size = new_size;
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_ring_pull(char *buffer, size_t size)
+{
+  assert(buffer != NULL);
+
+  PullState state = {buffer, size, 0};
+  return consume_records(pull_record, &state);
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_ring_flush(DebugOutput output_mode)
+{
+  assert(output_mode < DebugOutput_LAST);
+  assert(output_mode != DebugOutput_RingBuffer);
+
+  return consume_records(flush_record, &output_mode);
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_ring_get_lost(void)
+{
+  size_t total = 0;
+
+  for (DebugRing *ring = sync_load_ptr(&rings); ring != NULL;
+       ring = ring->next)
+  {
+    total += sync_load(&ring->lost);
+  }
+
+  return total;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_ring_vprintf(const char *format, va_list arg, bool newline)
+{
+  _Optional DebugRing *const optional_ring = get_thread_ring();
+  if (optional_ring == NULL)
+    return;
+
+  DebugRing *const ring = &*optional_ring;
+  size_t const mask = ring->size - 1;
+  size_t head = ring->head;
+  size_t const space = ring->size - (head - sync_load(&ring->tail));
+  size_t const contig = ring->size - (head & mask);
+  size_t const avail = LOWEST(space, contig);
+  va_list copy;
+  int nout;
+
+  va_copy(copy, arg);
+
+  /* Try to format the text straight into the free space before the end of
+     the buffer. There must be room for the header and a string terminator
+     (which isn't stored). */
+  if (avail > HEADER_SIZE)
+  {
+    nout = debug_fmt_vsnprintf(&ring->data[(head & mask) + HEADER_SIZE],
+                               avail - HEADER_SIZE, format, arg);
+  }
+  else
+  {
+    nout = debug_fmt_vsnprintf(NULL, 0, format, arg);
+  }
+
+  if (nout >= 0)
+  {
+    size_t len = (size_t)nout;
+
+    if (avail <= HEADER_SIZE || len >= avail - HEADER_SIZE)
+    {
+      /* Didn't fit: try again at the start of the buffer, if there is
+         enough free space there. */
+      size_t const wrapped = space - avail;
+
+      if (contig < space && wrapped > HEADER_SIZE &&
+          len < wrapped - HEADER_SIZE)
+      {
+        RecordHeader const pad = PADDING_RECORD;
+        memcpy(&ring->data[head & mask], &pad, HEADER_SIZE);
+
+        head += contig;
+        nout = debug_fmt_vsnprintf(&ring->data[HEADER_SIZE],
+                                   wrapped - HEADER_SIZE, format, copy);
+        if (nout < 0 || (size_t)nout != len)
+        {
+          /* Shouldn't happen unless an argument changed under our feet */
+          sync_store(&ring->head, head);
+          sync_store(&ring->lost, ring->lost + len);
+          va_end(copy);
+          return;
+        }
+      }
+      else
+      {
+        sync_store(&ring->lost, ring->lost + len);
+        va_end(copy);
+        return;
+      }
+    }
+
+    if (newline)
+    {
+      /* Overwrite the string terminator, for which space was reserved */
+      ring->data[(head & mask) + HEADER_SIZE + len++] = '\n';
+    }
+
+    /* Commit the record by publishing the new head position */
+    RecordHeader const header = (RecordHeader)len;
+    memcpy(&ring->data[head & mask], &header, HEADER_SIZE);
+    sync_store(&ring->head, head + record_span(len));
+  }
+
+  va_end(copy);
+}
@@ -0,0 +1,461 @@
+/*
+ * CBDebugLib: Rotation of log files by size
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+  CJB: 16-Oct-26: Reuse segments instead of freeing them, because a writer
+                  may still register with a segment after it is replaced.
+*/
+
+/* Needed for clock_gettime, nanosleep and posix_spawnp in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* Configuration, applied when a log file is next opened */
+static size_t rotate_size;
+static unsigned int rotate_files = 4;
+static bool rotate_compress;
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <errno.h>
+#include <time.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/* Text is written to the current segment of the log file until it reaches
+   the size limit, whereupon the writer that crossed the limit swaps in the
+   next segment, which was opened in advance by a background thread. The
+   same thread then waits for any other writers to finish with the old
+   segment, closes it, renames the older segments (compressing the newest
+   of them if required), and opens another segment ready for next time.
+   Writers never wait for any of this; if the next segment isn't ready in
+   time, they carry on appending to the current one.
+   Segments are never freed, because a writer may still register with a
+   segment after it was replaced; instead, closed segments are reused. At
+   most three are in use at once: the current, next and retired segments. */
+enum
+{
+  WaitMs = 100,     /* longest time before noticing a rotation */
+  PollNs = 100000,  /* interval between checks for writers to finish */
+  MaxPathSize = 256,
+  MaxSegments = 3
+};
+
+typedef struct
+{
+  FILE            *file;
+  bool             in_use;  /* only changed by the opener or closer */
+  volatile size_t  users;   /* number of writers using the segment */
+  volatile size_t  written; /* size of the segment */
+}
+Segment;
+
+static Segment segments[MaxSegments];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t rotator;
+static volatile size_t active;
+static bool stopping; /* protected by 'lock' */
+
+static void *volatile current; /* segment being written */
+static void *volatile next;    /* segment ready to replace it, if any */
+static void *volatile retired; /* segment awaiting rotation, if any */
+
+static char base_path[MaxPathSize], next_path[MaxPathSize];
+static size_t max_size;
+static unsigned int max_files;
+static bool compress;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static _Optional Segment *open_segment(const char *path, const char *mode)
+{
+  _Optional Segment *seg = NULL;
+  for (size_t i = 0; i < ARRAY_SIZE(segments) && seg == NULL; ++i)
+  {
+    if (!segments[i].in_use)
+      seg = &segments[i];
+  }
+  if (seg == NULL)
+    return NULL;
+
+  _Optional FILE *const file = fopen(path, mode);
+  if (file == NULL)
+    return NULL;
+
+  /* Text already in the file counts towards its size */
+  long size = 0;
+  if (fseek(&*file, 0, SEEK_END) == 0)
+    size = ftell(&*file);
+
+  /* Don't reset the number of users: a writer that loaded a stale pointer
+     to this segment may be about to undo its registration */
+  seg->file = &*file;
+  seg->in_use = true;
+  seg->written = size > 0 ? (size_t)size : 0;
+  return seg;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void close_segment(Segment *seg)
+{
+  /* Wait for writers that began using the segment before it was replaced */
+  while (sync_load(&seg->users) != 0)
+  {
+    struct timespec const ts = {0, PollNs};
+    (void)nanosleep(&ts, NULL);
+  }
+
+  (void)fclose(seg->file);
+  seg->in_use = false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool make_name(char *buffer, unsigned int n, const char *suffix)
+{
+  /* Construct the name of the nth most recent old segment */
+  int const nout = snprintf(buffer, MaxPathSize, "%s.%u%s", base_path, n,
+                            suffix);
+  return nout > 0 && nout < MaxPathSize;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void rename_old(unsigned int from, unsigned int to)
+{
+  static const char *const suffixes[] = {"", ".gz"};
+
+  for (size_t i = 0; i < ARRAY_SIZE(suffixes); ++i)
+  {
+    char old_name[MaxPathSize], new_name[MaxPathSize];
+    if (make_name(old_name, from, suffixes[i]) &&
+        make_name(new_name, to, suffixes[i]))
+    {
+      (void)rename(old_name, new_name);
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void compress_file(const char *path)
+{
+  /* gzip replaces the file with a compressed copy */
+  char path_copy[MaxPathSize];
+  STRCPY_SAFE(path_copy, path);
+  char gzip[] = "gzip", force[] = "-f";
+  char *argv[] = {gzip, force, path_copy, NULL};
+
+  pid_t pid;
+  if (posix_spawnp(&pid, gzip, NULL, NULL, argv, environ) == 0)
+  {
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+    {
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void rotate(Segment *old)
+{
+  close_segment(old);
+
+  /* The current segment is at 'next_path' until renamed below */
+  if (max_files == 0)
+  {
+    (void)remove(base_path);
+  }
+  else
+  {
+    char name[MaxPathSize];
+    if (make_name(name, max_files, ""))
+      (void)remove(name);
+    if (make_name(name, max_files, ".gz"))
+      (void)remove(name);
+
+    for (unsigned int n = max_files - 1; n > 0; --n)
+      rename_old(n, n + 1);
+
+    if (make_name(name, 1, ""))
+    {
+      (void)rename(base_path, name);
+      if (compress)
+        compress_file(name);
+    }
+  }
+
+  (void)rename(next_path, base_path);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void *rotator_thread(void *arg)
+{
+  NOT_USED(arg);
+
+  pthread_mutex_lock(&lock);
+
+  for (;;)
+  {
+    Segment *const old = sync_load_ptr(&retired);
+    if (old != NULL)
+    {
+      pthread_mutex_unlock(&lock);
+      rotate(old);
+      (void)sync_cas_ptr(&retired, old, NULL);
+      pthread_mutex_lock(&lock);
+    }
+
+    if (stopping)
+      break;
+
+    if (sync_load_ptr(&next) == NULL)
+    {
+      /* Prepare the segment to be used after the next rotation */
+      pthread_mutex_unlock(&lock);
+      _Optional Segment *const seg = open_segment(next_path, "w");
+      if (seg != NULL)
+        (void)sync_cas_ptr(&next, NULL, &*seg);
+      pthread_mutex_lock(&lock);
+    }
+
+    if (stopping || sync_load_ptr(&retired) != NULL)
+      continue;
+
+    /* Writers don't wait for the lock, so they can't always signal */
+    struct timespec deadline;
+    (void)clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += WaitMs * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    (void)pthread_cond_timedwait(&work_cond, &lock, &deadline);
+  }
+
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static Segment *acquire(void)
+{
+  /* Register as a user of the current segment, making sure that it wasn't
+     replaced before registration was seen */
+  for (;;)
+  {
+    Segment *const seg = sync_load_ptr(&current);
+    (void)sync_fetch_add(&seg->users, 1);
+    if (sync_load_ptr(&current) == seg)
+      return seg;
+
+    (void)sync_fetch_add(&seg->users, (size_t)-1);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void release(Segment *seg, size_t len)
+{
+  size_t const size = sync_fetch_add(&seg->written, len) + len;
+  (void)sync_fetch_add(&seg->users, (size_t)-1);
+
+  if (size < max_size)
+    return;
+
+  /* Only one writer can take the next segment */
+  Segment *const new_seg = sync_load_ptr(&next);
+  if (new_seg == NULL || !sync_cas_ptr(&next, new_seg, NULL))
+    return;
+
+  (void)sync_cas_ptr(&current, seg, new_seg);
+  (void)sync_cas_ptr(&retired, NULL, seg);
+
+  if (pthread_mutex_trylock(&lock) == 0)
+  {
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_rot_open(const char *path)
+{
+  assert(path != NULL);
+
+  if (rotate_size == 0 || sync_load(&active))
+    return false;
+
+  int const nout = snprintf(next_path, sizeof(next_path), "%s.next", path);
+  if (nout < 0 || (size_t)nout >= sizeof(next_path))
+    return false;
+
+  STRCPY_SAFE(base_path, path);
+  max_size = rotate_size;
+  max_files = rotate_files;
+  compress = rotate_compress;
+
+  _Optional Segment *const seg = open_segment(base_path, "a");
+  if (seg == NULL)
+    return false;
+
+  current = &*seg;
+  next = NULL;
+  retired = NULL;
+  stopping = false;
+
+  if (pthread_create(&rotator, NULL, rotator_thread, NULL) != 0)
+  {
+    close_segment(&*seg);
+    current = NULL;
+    return false;
+  }
+
+  sync_store(&active, 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_rot_close(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  /* Let the rotator finish any rotation in progress before it exits */
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+
+  (void)pthread_join(rotator, NULL);
+  sync_store(&active, 0);
+
+  Segment *const seg = sync_load_ptr(&current);
+  close_segment(seg);
+  current = NULL;
+
+  Segment *const spare = sync_load_ptr(&next);
+  if (spare != NULL)
+  {
+    close_segment(spare);
+    (void)remove(next_path);
+    next = NULL;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_rot_vprintf(const char *format, va_list arg, bool newline)
+{
+  if (!sync_load(&active))
+    return false;
+
+  Segment *const seg = acquire();
+  int const nout = debug_fmt_vfprintf(seg->file, format, arg, newline);
+  release(seg, nout > 0 ? (size_t)nout : 0);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_rot_write(const char *text, size_t len)
+{
+  if (!sync_load(&active))
+    return false;
+
+  Segment *const seg = acquire();
+  (void)fwrite(text, 1, len, seg->file);
+  release(seg, len);
+  return true;
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_rot_open(const char *path)
+{
+  NOT_USED(path);
+  return false; /* caller opens an ordinary file */
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_rot_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_rot_vprintf(const char *format, va_list arg, bool newline)
+{
+  NOT_USED(format);
+  NOT_USED(arg);
+  NOT_USED(newline);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_rot_write(const char *text, size_t len)
+{
+  NOT_USED(text);
+  NOT_USED(len);
+  return false;
+}
+
+#endif /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_set_rotation(size_t size, unsigned int files, bool gzip)
+{
+  rotate_size = size;
+  rotate_files = files;
+  rotate_compress = gzip;
+}
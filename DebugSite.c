@@ -0,0 +1,84 @@
+/*
+ * CBDebugLib: Counters for call sites of sampled debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+                  Hits are counted by file and line instead of in a static
+                  object at each call site.
+*/
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebSys.h"
+
+/* Call sites are identified by registering their file name and line
+   number with debug_site_intern, and hits are counted in a table indexed
+   by the resulting identifier. Each call site is added to a list the first
+   time it is reached, and is never removed. */
+static volatile size_t last_reached; /* identifier of site, or 0 */
+static size_t next_reached[DEBUG_SITE_ID_MAX];
+static volatile size_t hits[DEBUG_SITE_ID_MAX];
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+bool debug_site_hit(const char *file, unsigned long line,
+                    unsigned long period)
+{
+  assert(file != NULL);
+
+  DebugSiteId const id = debug_site_intern(file, line, NULL);
+  if (id == 0)
+    return true; /* registry is full, so don't limit this site */
+
+  size_t const count = sync_fetch_add(&hits[id - 1], 1);
+  if (count == 0)
+  {
+    /* Only one thread can see the first hit, so only one thread adds the
+       site to the list */
+    do
+    {
+      next_reached[id - 1] = sync_load(&last_reached);
+    }
+    while (!sync_cas(&last_reached, next_reached[id - 1], id));
+  }
+
+  return period == 0 ? count == 0 : count % period == 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_dump_sites(void)
+{
+  for (size_t id = sync_load(&last_reached); id != 0;
+       id = next_reached[id - 1])
+  {
+    DebugSiteInfo info;
+    if (!debug_site_info((DebugSiteId)id, &info))
+      continue;
+
+    debug_printfl("%s: %lu hits", info.location,
+                  (unsigned long)sync_load(&hits[id - 1]));
+  }
+}
@@ -0,0 +1,352 @@
+/*
+ * CBDebugLib: Debugging output to a local datagram socket
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for sendmmsg (and clock_gettime in strict ISO C mode) */
+#define _GNU_SOURCE
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/* Each line is sent as one datagram consisting of a header identifying
+   the session, a tab and the text of the line. Writers copy lines into a
+   shared batch, and a background thread sends every line in the batch
+   with as few system calls as possible. Writers never wait for the
+   collector: lines are discarded if the batch is full or the collector
+   isn't listening, as with SysLog. */
+#define SOCKET_VAR "CBDEBUG_SOCKET"
+
+enum
+{
+  BatchSize = 128 * 1024,
+  MaxLines = 2048,
+  BatchMs = 20,        /* longest time that a line waits to be sent */
+  SendLines = 64,      /* target number of lines per batch */
+  SendTimeoutMs = 500, /* longest time to wait for the collector */
+  HeaderSize = 80,
+  MaxLineSize = 8192   /* longer lines are truncated */
+};
+
+typedef struct
+{
+  char   data[BatchSize];
+  size_t used;
+  size_t nlines;
+  size_t offsets[MaxLines];
+  size_t lengths[MaxLines];
+}
+Batch;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sender;
+static volatile size_t active;
+static volatile size_t dropped;
+static int sock = -1;
+static struct sockaddr_un address;
+static char header[HeaderSize];
+static size_t header_len;
+
+/* The following variables are protected by 'lock' */
+static Batch batches[2];
+static Batch *filling = &batches[0];
+static bool stopping;
+static struct timespec oldest; /* when the batch became non-empty */
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void send_batch(const Batch *batch)
+{
+  size_t sent = 0;
+
+  while (sent < batch->nlines)
+  {
+#ifdef __linux__
+    struct mmsghdr msgs[SendLines];
+    struct iovec iov[SendLines];
+    unsigned int const n = (unsigned int)LOWEST(batch->nlines - sent,
+                                                (size_t)SendLines);
+
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      iov[i].iov_base = (void *)(batch->data + batch->offsets[sent + i]);
+      iov[i].iov_len = batch->lengths[sent + i];
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = &address;
+      msgs[i].msg_hdr.msg_namelen = sizeof(address);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int const nsent = sendmmsg(sock, msgs, n, 0);
+#else
+    int nsent = -1;
+    if (sendto(sock, batch->data + batch->offsets[sent],
+               batch->lengths[sent], 0, (struct sockaddr *)&address,
+               sizeof(address)) >= 0)
+    {
+      nsent = 1;
+    }
+#endif
+    if (nsent > 0)
+    {
+      sent += (size_t)nsent;
+    }
+    else if (nsent < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else
+    {
+      /* Probably no collector, so discard the rest of the batch */
+      (void)sync_fetch_add(&dropped, batch->nlines - sent);
+      break;
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void *sender_thread(void *arg)
+{
+  NOT_USED(arg);
+
+  pthread_mutex_lock(&lock);
+
+  for (;;)
+  {
+    while (!stopping && filling->nlines == 0)
+      (void)pthread_cond_wait(&work_cond, &lock);
+
+    if (filling->nlines == 0)
+      break; /* stopping, with nothing left to send */
+
+    /* Let more lines join the batch until the oldest is due */
+    struct timespec deadline = oldest;
+    deadline.tv_nsec += BatchMs * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (!stopping && filling->nlines < SendLines)
+    {
+      if (pthread_cond_timedwait(&work_cond, &lock, &deadline) == ETIMEDOUT)
+        break;
+    }
+
+    /* Swap batches so that writers needn't wait whilst this one is sent */
+    Batch *const full = filling;
+    filling = (full == &batches[0]) ? &batches[1] : &batches[0];
+    filling->used = 0;
+    filling->nlines = 0;
+
+    pthread_mutex_unlock(&lock);
+    send_batch(full);
+    pthread_mutex_lock(&lock);
+  }
+
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+size_t debug_sock_get_dropped(void)
+{
+  return sync_load(&dropped);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_sock_open(const char *log_name)
+{
+  assert(log_name != NULL);
+
+  if (sync_load(&active))
+    return false;
+
+  _Optional const char *const path = getenv(SOCKET_VAR);
+  const char *const sock_path = path != NULL ? &*path : DEBUG_SOCKET_PATH;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(sock_path) >= sizeof(address.sun_path))
+    return false;
+
+  strcpy(address.sun_path, sock_path);
+
+  /* Like a SysLog session, each opening of the output is identified
+     separately, even within the same process */
+  static unsigned int sessions;
+  int const nout = snprintf(header, sizeof(header), "%ld.%u %.40s\t",
+                            (long)getpid(), ++sessions, log_name);
+  if (nout < 0 || (size_t)nout >= sizeof(header))
+    return false;
+
+  header_len = (size_t)nout;
+
+  sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0)
+    return false;
+
+  /* Only the sender waits for the collector, and then not indefinitely */
+  struct timeval const timeout = {0, SendTimeoutMs * 1000L};
+  (void)setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  stopping = false;
+  filling = &batches[0];
+  filling->used = 0;
+  filling->nlines = 0;
+
+  if (pthread_create(&sender, NULL, sender_thread, NULL) != 0)
+  {
+    (void)close(sock);
+    sock = -1;
+    return false;
+  }
+
+  sync_store(&active, 1);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sock_close(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  /* Let the sender send the remaining lines before it exits */
+  sync_store(&active, 0);
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+
+  (void)pthread_join(sender, NULL);
+
+  (void)close(sock);
+  sock = -1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sock_line(const char *line, size_t len, void *arg)
+{
+  assert(line != NULL);
+  NOT_USED(arg);
+
+  if (!sync_load(&active))
+    return;
+
+  len = LOWEST(len, (size_t)MaxLineSize);
+  size_t const size = header_len + len;
+
+  pthread_mutex_lock(&lock);
+
+  if (filling->nlines >= MaxLines || size > BatchSize - filling->used)
+  {
+    (void)sync_fetch_add(&dropped, 1);
+  }
+  else
+  {
+    if (filling->nlines == 0)
+    {
+      (void)clock_gettime(CLOCK_REALTIME, &oldest);
+      pthread_cond_signal(&work_cond); /* start the clock */
+    }
+
+    char *const p = filling->data + filling->used;
+    memcpy(p, header, header_len);
+    memcpy(p + header_len, line, len);
+    filling->offsets[filling->nlines] = filling->used;
+    filling->lengths[filling->nlines] = size;
+    filling->used += size;
+
+    if (++filling->nlines == SendLines)
+      pthread_cond_signal(&work_cond);
+  }
+
+  pthread_mutex_unlock(&lock);
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+size_t debug_sock_get_dropped(void)
+{
+  return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_sock_open(const char *log_name)
+{
+  NOT_USED(log_name);
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sock_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sock_line(const char *line, size_t len, void *arg)
+{
+  NOT_USED(line);
+  NOT_USED(len);
+  NOT_USED(arg);
+}
+
+#endif /* CBDEBUG_POSIX */
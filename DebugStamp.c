@@ -0,0 +1,238 @@
+/*
+ * CBDebugLib: Timestamps and thread identifiers for lines of debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+/* On x86-64, time is measured by the processor's timestamp counter, which
+   is much cheaper to read than any system clock. The counter's frequency
+   is calibrated against the monotonic clock once enough time has passed
+   since prefixes were first enabled; until then, the clock is read directly.
+   Elsewhere, the monotonic clock (or the C library's processor clock) is
+   always used. */
+#if defined(CBDEBUG_POSIX) && defined(__x86_64__)
+#define USE_TSC
+#endif
+
+enum
+{
+  CalibrationNs = 100 * 1000 * 1000
+};
+
+static unsigned int prefix_flags;
+static volatile size_t last_us; /* time of the previous prefixed line */
+static volatile size_t next_thread = 1;
+static THREAD_LOCAL unsigned long thread_id;
+static THREAD_LOCAL bool mid_line; /* previous output didn't end a line */
+
+#ifdef CBDEBUG_POSIX
+static unsigned long long base_ns;
+#endif
+
+#ifdef USE_TSC
+static unsigned long long base_tsc;
+static double ns_per_tick;
+static volatile size_t calibrated;
+#endif
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+#ifdef CBDEBUG_POSIX
+static unsigned long long clock_ns(void)
+{
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ull +
+         (unsigned long long)ts.tv_nsec;
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned long long elapsed_us(void)
+{
+  /* Get the time since prefixes were enabled */
+#if defined(USE_TSC)
+  unsigned long long const ticks = __builtin_ia32_rdtsc() - base_tsc;
+  if (sync_load(&calibrated))
+    return (unsigned long long)((double)ticks * ns_per_tick) / 1000u;
+
+  unsigned long long const ns = clock_ns() - base_ns;
+  if (ns >= CalibrationNs && ticks > 0)
+  {
+    /* Only one thread stores the counter's period */
+    static volatile size_t calibrating;
+    if (sync_cas(&calibrating, 0, 1))
+    {
+      ns_per_tick = (double)ns / (double)ticks;
+      sync_store(&calibrated, 1);
+    }
+  }
+  return ns / 1000u;
+#elif defined(CBDEBUG_POSIX)
+  return (clock_ns() - base_ns) / 1000u;
+#else
+  return (unsigned long long)((double)clock() * (1e6 / CLOCKS_PER_SEC));
+#endif
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_set_prefix(unsigned int flags)
+{
+  assert(!(flags & ~(unsigned)(DebugPrefix_Time | DebugPrefix_Delta |
+                               DebugPrefix_Thread)));
+
+  if (flags != 0 && prefix_flags == 0)
+  {
+    /* Times are relative to when prefixes were enabled */
+#ifdef CBDEBUG_POSIX
+    base_ns = clock_ns();
+#endif
+#ifdef USE_TSC
+    /* The counter's period is kept once measured because it doesn't
+       change */
+    base_tsc = __builtin_ia32_rdtsc();
+#endif
+    sync_store(&last_us, (size_t)elapsed_us());
+  }
+
+  prefix_flags = flags;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_stamp_take(DebugStamp *stamp, const char *format, bool newline)
+{
+  assert(stamp != NULL);
+  assert(format != NULL);
+
+  unsigned int const flags = prefix_flags;
+  if (flags == 0)
+    return false;
+
+  /* Only the first output to a line is prefixed. Output is assumed to end
+     a line if its format string does. */
+  bool const start = !mid_line;
+  size_t const flen = strlen(format);
+  mid_line = !newline && (flen == 0 || format[flen - 1] != '\n');
+  if (!start)
+    return false;
+
+  stamp->flags = flags;
+  stamp->time_us = 0;
+  stamp->delta_us = 0;
+  stamp->thread = 0;
+
+  if (flags & (DebugPrefix_Time | DebugPrefix_Delta))
+  {
+    unsigned long long const now = elapsed_us();
+    stamp->time_us = now;
+
+    if (flags & DebugPrefix_Delta)
+    {
+      /* Exchange the time of the previous line for this one's. The stored
+         time may wrap around if size_t is narrow, but the difference is
+         still correct for intervals shorter than the period. */
+      size_t prev;
+      do
+      {
+        prev = sync_load(&last_us);
+      }
+      while (!sync_cas(&last_us, prev, (size_t)now));
+
+      stamp->delta_us = (size_t)now - prev;
+    }
+  }
+
+  if (flags & DebugPrefix_Thread)
+    stamp->thread = debug_stamp_thread();
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+size_t debug_stamp_format(char *buffer, size_t size, const DebugStamp *stamp)
+{
+  assert(buffer != NULL);
+  assert(size > 0);
+  assert(stamp != NULL);
+
+  size_t len = 0;
+  buffer[0] = '\0';
+
+  if (stamp->flags & DebugPrefix_Time)
+  {
+    int const nout = snprintf(buffer + len, size - len, "%llu.%06llu ",
+                              stamp->time_us / 1000000u,
+                              stamp->time_us % 1000000u);
+    if (nout > 0)
+      len = LOWEST(len + (size_t)nout, size - 1);
+  }
+
+  if (stamp->flags & DebugPrefix_Delta)
+  {
+    int const nout = snprintf(buffer + len, size - len, "+%llu.%06llu ",
+                              stamp->delta_us / 1000000u,
+                              stamp->delta_us % 1000000u);
+    if (nout > 0)
+      len = LOWEST(len + (size_t)nout, size - 1);
+  }
+
+  if (stamp->flags & DebugPrefix_Thread)
+  {
+    int const nout = snprintf(buffer + len, size - len, "T%lu ",
+                              stamp->thread);
+    if (nout > 0)
+      len = LOWEST(len + (size_t)nout, size - 1);
+  }
+
+  return len;
+}
+
+/* ----------------------------------------------------------------------- */
+
+unsigned long debug_stamp_thread(void)
+{
+  if (thread_id == 0)
+    thread_id = (unsigned long)sync_fetch_add(&next_thread, 1);
+
+  return thread_id;
+}
@@ -0,0 +1,290 @@
+/*
+ * CBDebugLib: Group commit of debugging output to a log file
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for fileno, fdatasync and clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <time.h>
+#include <unistd.h>
+
+/* Writers append to the log file's stream buffer and then note what they
+   wrote. A committer thread waits until the oldest uncommitted line is
+   due (or enough text is waiting) and then flushes the stream and
+   synchronises the file with stable storage on behalf of all of them.
+   Lines written whilst a commit is in progress join the next one. */
+enum
+{
+  CommitMsDefault = 50,
+  CommitBytesDefault = 4096
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t committer;
+static volatile size_t active;
+
+/* The following variables are protected by 'lock' */
+static _Optional FILE *commit_file;
+static bool stopping;
+static unsigned int commit_ms = CommitMsDefault;
+static size_t commit_bytes = CommitBytesDefault;
+static unsigned long pending_lines;
+static size_t pending_bytes;
+static struct timespec oldest; /* when 'pending_lines' became non-zero */
+static DebugCommitStats stats;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static void commit(FILE *file)
+{
+  (void)fflush(file);
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+  (void)fdatasync(fileno(file));
+#else
+  (void)fsync(fileno(file));
+#endif
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void *committer_thread(void *arg)
+{
+  FILE *const file = arg;
+
+  pthread_mutex_lock(&lock);
+
+  for (;;)
+  {
+    while (!stopping && pending_lines == 0)
+      (void)pthread_cond_wait(&work_cond, &lock);
+
+    if (pending_lines == 0)
+      break; /* stopping, with nothing left to commit */
+
+    /* Let other lines join this commit until the oldest is due */
+    struct timespec deadline = oldest;
+    deadline.tv_sec += (time_t)(commit_ms / 1000);
+    deadline.tv_nsec += (long)(commit_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (!stopping && pending_bytes < commit_bytes)
+    {
+      if (pthread_cond_timedwait(&work_cond, &lock, &deadline) == ETIMEDOUT)
+        break;
+    }
+
+    unsigned long const lines = pending_lines;
+    pending_lines = 0;
+    pending_bytes = 0;
+
+    pthread_mutex_unlock(&lock);
+    commit(file);
+    pthread_mutex_lock(&lock);
+
+    stats.commits++;
+    stats.lines += lines;
+    stats.last_lines = lines;
+    if (lines > stats.max_lines)
+      stats.max_lines = lines;
+  }
+
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_get_commit_stats(DebugCommitStats *s)
+{
+  assert(s != NULL);
+
+  pthread_mutex_lock(&lock);
+  *s = stats;
+  pthread_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_sync_open(FILE *file)
+{
+  assert(file != NULL);
+
+  if (sync_load(&active))
+    return;
+
+  pthread_mutex_lock(&lock);
+  commit_file = file;
+  stopping = false;
+  pending_lines = 0;
+  pending_bytes = 0;
+  memset(&stats, 0, sizeof(stats));
+  pthread_mutex_unlock(&lock);
+
+  if (pthread_create(&committer, NULL, committer_thread, file) == 0)
+    sync_store(&active, 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_close(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  /* Let the committer commit the remaining lines before it exits */
+  pthread_mutex_lock(&lock);
+  stopping = true;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+
+  (void)pthread_join(committer, NULL);
+  sync_store(&active, 0);
+
+  pthread_mutex_lock(&lock);
+  commit_file = NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_sync_written(size_t len)
+{
+  if (!sync_load(&active))
+    return false;
+
+  pthread_mutex_lock(&lock);
+
+  if (pending_lines++ == 0)
+  {
+    (void)clock_gettime(CLOCK_REALTIME, &oldest);
+    pthread_cond_signal(&work_cond); /* start the clock */
+  }
+
+  pending_bytes += len;
+  if (pending_bytes >= commit_bytes)
+    pthread_cond_signal(&work_cond);
+
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_commit(void)
+{
+  if (!sync_load(&active))
+    return;
+
+  /* Don't wait for the lock, in case it is held by the caller */
+  _Optional FILE *file = NULL;
+  if (pthread_mutex_trylock(&lock) == 0)
+  {
+    file = commit_file;
+    pthread_mutex_unlock(&lock);
+  }
+
+  if (file != NULL)
+    commit(&*file);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_set_limits(unsigned int max_ms, size_t max_bytes)
+{
+  pthread_mutex_lock(&lock);
+  commit_ms = max_ms;
+  commit_bytes = max_bytes;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&lock);
+}
+
+#else /* CBDEBUG_POSIX */
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_get_commit_stats(DebugCommitStats *s)
+{
+  assert(s != NULL);
+  memset(s, 0, sizeof(*s));
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+void debug_sync_open(FILE *file)
+{
+  NOT_USED(file);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_close(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+bool debug_sync_written(size_t len)
+{
+  NOT_USED(len);
+  return false; /* caller flushes every line */
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_commit(void)
+{
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_sync_set_limits(unsigned int max_ms, size_t max_bytes)
+{
+  NOT_USED(max_ms);
+  NOT_USED(max_bytes);
+}
+
+#endif /* CBDEBUG_POSIX */
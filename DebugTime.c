@@ -0,0 +1,299 @@
+/*
+ * CBDebugLib: Latency histograms for timed regions of code
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebSys.h"
+
+/* Regions are numbered in order of registration, starting from 1, and
+   regions with the same name share a number. Each thread records the
+   duration of each region in its own histogram, which only it updates, so
+   recording never waits for a lock. Histograms are log-linear: durations
+   below 2^SubBits nanoseconds have a bucket each, and each power of two
+   above that is divided into 2^SubBits buckets of equal width, so that
+   any duration is known to within 1/2^SubBits. Histograms are never freed,
+   so that the report includes threads that have finished. */
+enum
+{
+  MaxRegions = 64,
+  SubBits = 3,
+  SubBuckets = 1 << SubBits,
+  MaxExponent = 40, /* about 18 minutes; longer durations are clamped */
+  Buckets = (MaxExponent - SubBits + 2) * SubBuckets
+};
+
+typedef struct
+{
+  volatile size_t counts[Buckets];
+  volatile size_t max_ns;
+}
+Histogram;
+
+typedef struct ThreadTimes
+{
+  struct ThreadTimes *next;
+  void *volatile      histograms[MaxRegions]; /* Histogram pointers */
+}
+ThreadTimes;
+
+static DebugMutex lock = DEBUG_MUTEX_INIT;
+static const char *names[MaxRegions];
+static volatile size_t count;
+static void *volatile threads; /* ThreadTimes list */
+static THREAD_LOCAL _Optional ThreadTimes *thread_times;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static unsigned long long now_ns(void)
+{
+#ifdef CBDEBUG_POSIX
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ull +
+         (unsigned long long)ts.tv_nsec;
+#else
+  return (unsigned long long)((double)clock() * (1e9 / CLOCKS_PER_SEC));
+#endif
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t bucket_index(unsigned long long ns)
+{
+  if (ns < SubBuckets)
+    return (size_t)ns;
+
+  unsigned int exponent;
+#ifdef __GNUC__
+  exponent = 63u - (unsigned int)__builtin_clzll(ns);
+#else
+  exponent = 0;
+  for (unsigned long long v = ns; v > 1; v >>= 1)
+    ++exponent;
+#endif
+
+  if (exponent > MaxExponent)
+    return Buckets - 1;
+
+  size_t const sub = (size_t)(ns >> (exponent - SubBits)) & (SubBuckets - 1);
+  return (exponent - SubBits + 1) * SubBuckets + sub;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned long long bucket_limit(size_t index)
+{
+  /* Get the greatest duration recorded in a bucket */
+  if (index < SubBuckets)
+    return index;
+
+  unsigned int const shift = (unsigned int)(index / SubBuckets) - 1;
+  unsigned long long const sub = SubBuckets + (index % SubBuckets);
+  return ((sub + 1) << shift) - 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t register_region(DebugTimeRegion *region)
+{
+  debug_mutex_lock(&lock);
+
+  /* Another thread may have registered the region since it was checked */
+  size_t id = sync_load(&region->id);
+  if (id == 0)
+  {
+    size_t const n = sync_load(&count);
+    for (size_t i = 0; i < n && id == 0; ++i)
+    {
+      if (strcmp(names[i], region->name) == 0)
+        id = i + 1;
+    }
+
+    if (id == 0 && n < MaxRegions)
+    {
+      names[n] = region->name;
+      id = n + 1;
+      sync_store(&count, id);
+    }
+
+    /* Don't try again if there are too many regions */
+    sync_store(&region->id, id == 0 ? SIZE_MAX : id);
+  }
+
+  debug_mutex_unlock(&lock);
+  return id;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static _Optional Histogram *get_histogram(size_t id)
+{
+  _Optional ThreadTimes *times = thread_times;
+  if (times == NULL)
+  {
+    /* The first region timed by this thread */
+    times = calloc(1, sizeof(*times));
+    if (times == NULL)
+      return NULL;
+
+    do
+    {
+      times->next = sync_load_ptr(&threads);
+    }
+    while (!sync_cas_ptr(&threads, times->next, &*times));
+
+    thread_times = times;
+  }
+
+  void *volatile *const slot = &(&*times)->histograms[id - 1];
+  _Optional Histogram *hist = sync_load_ptr(slot);
+  if (hist == NULL)
+  {
+    hist = calloc(1, sizeof(*hist));
+    if (hist != NULL)
+      (void)sync_cas_ptr(slot, NULL, &*hist);
+  }
+  return hist;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void report_region(size_t id)
+{
+  /* Merge the histograms of every thread */
+  size_t totals[Buckets] = {0};
+  size_t calls = 0, max_ns = 0;
+
+  for (const ThreadTimes *times = sync_load_ptr(&threads); times != NULL;
+       times = times->next)
+  {
+    _Optional const Histogram *const hist =
+      sync_load_ptr(&times->histograms[id - 1]);
+    if (hist == NULL)
+      continue;
+
+    for (size_t i = 0; i < Buckets; ++i)
+    {
+      size_t const n = sync_load(&hist->counts[i]);
+      totals[i] += n;
+      calls += n;
+    }
+    size_t const hist_max = sync_load(&hist->max_ns);
+    if (hist_max > max_ns)
+      max_ns = hist_max;
+  }
+
+  if (calls == 0)
+    return;
+
+  /* Find the buckets in which the median and 99th percentile lie */
+  size_t const p50_rank = (calls + 1) / 2, p99_rank = calls - calls / 100;
+  unsigned long long p50 = 0, p99 = 0;
+  size_t seen = 0;
+
+  for (size_t i = 0; i < Buckets; ++i)
+  {
+    if (seen < p50_rank && seen + totals[i] >= p50_rank)
+      p50 = bucket_limit(i);
+
+    if (seen < p99_rank && seen + totals[i] >= p99_rank)
+      p99 = bucket_limit(i);
+
+    seen += totals[i];
+  }
+
+  debug_printfl("%s: %zu calls, p50 %.3f us, p99 %.3f us, max %.3f us",
+                names[id - 1], calls,
+                (double)LOWEST(p50, max_ns) / 1000.0,
+                (double)LOWEST(p99, max_ns) / 1000.0,
+                (double)max_ns / 1000.0);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+unsigned long long debug_time_begin(DebugTimeRegion *region)
+{
+  assert(region != NULL);
+  assert(region->name != NULL);
+
+  if (sync_load(&region->id) == 0)
+    (void)register_region(region);
+
+  return now_ns();
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_time_end(DebugTimeRegion *region, unsigned long long start)
+{
+  assert(region != NULL);
+
+  unsigned long long const ns = now_ns() - start;
+  size_t const id = sync_load(&region->id);
+  if (id == 0 || id > MaxRegions)
+    return;
+
+  _Optional Histogram *const hist = get_histogram(id);
+  if (hist == NULL)
+    return;
+
+  /* Only this thread updates its own histogram */
+  size_t const i = bucket_index(ns);
+  sync_store(&hist->counts[i], hist->counts[i] + 1);
+
+  size_t const clamped = ns < SIZE_MAX ? (size_t)ns : SIZE_MAX;
+  if (clamped > hist->max_ns)
+    sync_store(&hist->max_ns, clamped);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_time_scope_end(DebugTimeScope *scope)
+{
+  assert(scope != NULL);
+  debug_time_end(scope->region, scope->start);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_time_report(void)
+{
+  size_t const n = sync_load(&count);
+
+  for (size_t id = 1; id <= n; ++id)
+    report_region(id);
+}
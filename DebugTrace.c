@@ -0,0 +1,202 @@
+/*
+ * CBDebugLib: Timelines of debugging output in Chrome's trace event format
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Local headers */
+#include "Debug.h"
+#include "Internal/CBDebMisc.h"
+#include "Internal/CBDebOut.h"
+#include "Internal/CBDebSys.h"
+
+#ifdef CBDEBUG_POSIX
+/* POSIX headers */
+#include <unistd.h>
+#endif
+
+/* The file is a JSON array of event objects, which is the simplest form
+   accepted by chrome://tracing and Perfetto. Spans are recorded as pairs
+   of begin ("B") and end ("E") events, and each line of text as an
+   instant ("i") event, all stamped with the time in microseconds since the
+   file was opened. The closing bracket is only written when the file is
+   closed, but trace viewers don't require it, so the file is still usable
+   after a crash. */
+enum
+{
+  MaxNameLen = 200, /* longer lines are truncated */
+  EventSize = (MaxNameLen * 6) + 128 /* every character might be escaped */
+};
+
+static DebugMutex lock = DEBUG_MUTEX_INIT;
+static _Optional FILE *trace_file;
+static volatile size_t active;
+static bool first_event;
+static unsigned long long base_ns;
+static unsigned long process_id;
+
+/* ----------------------------------------------------------------------- */
+/*                         Private functions                               */
+
+static unsigned long long now_ns(void)
+{
+#ifdef CBDEBUG_POSIX
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ull +
+         (unsigned long long)ts.tv_nsec;
+#else
+  return (unsigned long long)((double)clock() * (1e9 / CLOCKS_PER_SEC));
+#endif
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_event(char phase, const char *name, size_t len)
+{
+  if (!sync_load(&active))
+    return;
+
+  unsigned long long const ns = now_ns() - base_ns;
+
+  /* Don't split a multibyte character when truncating a long name */
+  if (len > MaxNameLen)
+  {
+    len = MaxNameLen;
+    while (len > 0 && ((unsigned char)name[len] & 0xc0) == 0x80)
+      --len;
+  }
+
+  char event[EventSize];
+  size_t n = debug_kv_quote(event, sizeof(event), name, len);
+  int const nout = snprintf(event + n, sizeof(event) - n,
+                            ",\"ph\":\"%c\",%s\"ts\":%llu.%03u,"
+                            "\"pid\":%lu,\"tid\":%lu}",
+                            phase, phase == 'i' ? "\"s\":\"t\"," : "",
+                            ns / 1000u, (unsigned int)(ns % 1000u),
+                            process_id, debug_stamp_thread());
+  if (nout < 0)
+    return;
+
+  n = LOWEST(n + (size_t)nout, sizeof(event) - 1);
+
+  debug_mutex_lock(&lock);
+  if (trace_file != NULL)
+  {
+    (void)fputs(first_event ? "{\"name\":" : ",\n{\"name\":", &*trace_file);
+    (void)fwrite(event, 1, n, &*trace_file);
+    first_event = false;
+  }
+  debug_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+/*                         Public functions                                */
+
+void debug_trace_begin(const char *name)
+{
+  assert(name != NULL);
+  write_event('B', name, strlen(name));
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_trace_end(const char *name)
+{
+  assert(name != NULL);
+  write_event('E', name, strlen(name));
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_trace_instant(const char *name)
+{
+  assert(name != NULL);
+  write_event('i', name, strlen(name));
+}
+
+/* ----------------------------------------------------------------------- */
+/*                     Library-internal functions                          */
+
+bool debug_trace_open(const char *path)
+{
+  assert(path != NULL);
+
+  debug_mutex_lock(&lock);
+
+  if (trace_file == NULL)
+  {
+    /* Each trace starts afresh because a file can only hold one array */
+    trace_file = fopen(path, "w");
+    if (trace_file != NULL)
+    {
+      (void)fputs("[\n", &*trace_file);
+      first_event = true;
+      base_ns = now_ns();
+#ifdef CBDEBUG_POSIX
+      process_id = (unsigned long)getpid();
+#else
+      process_id = 1;
+#endif
+      sync_store(&active, 1);
+    }
+  }
+
+  debug_mutex_unlock(&lock);
+  return trace_file != NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_trace_close(void)
+{
+  sync_store(&active, 0);
+
+  debug_mutex_lock(&lock);
+
+  if (trace_file != NULL)
+  {
+    (void)fputs("\n]\n", &*trace_file);
+    fclose(&*trace_file);
+    trace_file = NULL;
+  }
+
+  debug_mutex_unlock(&lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+void debug_trace_line(const char *line, size_t len, void *arg)
+{
+  assert(line != NULL);
+  NOT_USED(arg);
+
+  write_event('i', line, len);
+}
@@ -0,0 +1,475 @@
+/*
+ * CBDebugLib: Interfaces between the debug output engine and its back-ends
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* History:
+  CJB: 16-Oct-26: Created.
+*/
+
+#ifndef CBDebOut_h
+#define CBDebOut_h
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Debug.h must be included before this header */
+
+/* Prefix for a line of debugging output */
+typedef struct
+{
+  unsigned int       flags;    /* DebugPrefix values */
+  unsigned long long time_us;
+  unsigned long long delta_us;
+  unsigned long      thread;
+}
+DebugStamp;
+
+/* Implemented by Debug.c */
+
+bool debug_make_path(char */*buffer*/, size_t /*size*/,
+                     const char */*leaf_name*/);
+   /*
+    * Constructs the path of a file in the directory used for log files.
+    * Returns: false if the path was truncated to fit in the buffer.
+    */
+
+void debug_flush_repeats(void);
+   /*
+    * Outputs the number of times that the last line was repeated, if a run
+    * of repeated lines is pending, without waiting for other threads. Used
+    * on abort, so that the count isn't lost.
+    */
+
+void debug_output_text(DebugOutput /*output_mode*/, const char */*text*/,
+                       size_t /*len*/);
+   /*
+    * Writes 'len' characters of preformatted text to the specified output,
+    * temporarily opening any file or log that it requires if the current
+    * output mode is DebugOutput_RingBuffer. Text destined for an output
+    * whose resources are unavailable is discarded.
+    */
+
+/* Implemented by DebugRing.c */
+
+void debug_ring_vprintf(const char */*format*/, va_list /*arg*/,
+                        bool /*newline*/);
+   /*
+    * Appends a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to the calling
+    * thread's ring buffer, or discards it if there isn't enough free space.
+    */
+
+/* Implemented by DebugAsync.c */
+
+bool debug_async_open(FILE */*file*/, bool /*flushed*/);
+   /*
+    * Starts a background thread to write text to the given log file, if
+    * asynchronous output was enabled by debug_set_async. The file must
+    * remain open until debug_async_close is called.
+    * Returns: true if asynchronous output was started.
+    */
+
+void debug_async_close(void);
+   /*
+    * Writes any queued text and then stops the background thread, if any.
+    */
+
+void debug_async_abort(void);
+   /*
+    * Writes any queued text without waiting for the background thread, and
+    * commits it to storage in DebugOutput_FlushedFile mode. Does nothing if
+    * another thread holds the lock on the queue. Used on abort.
+    */
+
+bool debug_async_write(const char */*text*/, size_t /*len*/);
+   /*
+    * Queues 'len' characters of preformatted text for the background
+    * thread to write.
+    * Returns: false if asynchronous output isn't active.
+    */
+
+bool debug_async_vprintf(const char */*format*/, va_list /*arg*/,
+                         bool /*newline*/);
+   /*
+    * Queues a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) for the background
+    * thread to write.
+    * Returns: false if asynchronous output isn't active (in which case
+    *          'arg' is unused).
+    */
+
+/* Implemented by DebugBin.c */
+
+void debug_bin_start(FILE */*file*/);
+   /*
+    * Writes a header record to a binary log file and forgets any call sites
+    * defined in a previous session.
+    */
+
+void debug_bin_vprintf(FILE */*file*/, DebugCategory /*category*/,
+                       _Optional const DebugStamp */*stamp*/,
+                       const char */*format*/, va_list /*arg*/,
+                       bool /*newline*/);
+   /*
+    * Writes a record of the format string and variadic arguments (and
+    * the category of output, whether a line feed should follow, and the
+    * line's prefix if 'stamp' is not null) to a binary log file, preceded
+    * by a definition of the format string if it wasn't seen before.
+    */
+
+void debug_bin_write(FILE */*file*/, DebugCategory /*category*/,
+                     const char */*text*/, size_t /*len*/);
+   /*
+    * Writes a record of 'len' characters of preformatted text (and the
+    * category of output) to a binary log file.
+    */
+
+void debug_bin_kv(FILE */*file*/, DebugCategory /*category*/,
+                  _Optional const DebugStamp */*stamp*/,
+                  const char */*event*/, const DebugKV */*pairs*/,
+                  size_t /*count*/);
+   /*
+    * Writes a record of an event name and an array of 'count' key/value
+    * pairs (and the category of output, and the line's prefix if 'stamp' is
+    * not null) to a binary log file, preceded by definitions of any names
+    * and keys that weren't seen before.
+    */
+
+/* Implemented by DebugMap.c */
+
+bool debug_map_open(const char */*path*/);
+   /*
+    * Opens a log file to which text will be appended by copying it into
+    * memory mapped from the file. Any null bytes at the end of the file
+    * (left by a program that terminated without closing it) are
+    * overwritten.
+    * Returns: false if the file couldn't be opened or memory-mapped files
+    *          aren't supported on this platform.
+    */
+
+void debug_map_close(void);
+   /*
+    * Unmaps and closes the log file opened by debug_map_open, if any,
+    * after truncating it to the length of the text written.
+    */
+
+bool debug_map_write(const char */*text*/, size_t /*len*/);
+   /*
+    * Appends 'len' characters of preformatted text to the memory-mapped
+    * log file.
+    * Returns: false if no memory-mapped log file is open.
+    */
+
+bool debug_map_vprintf(const char */*format*/, va_list /*arg*/,
+                       bool /*newline*/);
+   /*
+    * Appends a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to the memory-mapped
+    * log file.
+    * Returns: false if no memory-mapped log file is open.
+    */
+
+/* Implemented by DebugRec.c */
+
+void debug_rec_vprintf(const char */*format*/, va_list /*arg*/,
+                       bool /*newline*/);
+   /*
+    * Copies a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to the flight
+    * recorder, if enabled. Only for output that isn't otherwise formatted.
+    * Overlong strings are truncated.
+    */
+
+bool debug_rec_enabled(void);
+   /*
+    * Returns: true if the flight recorder has a non-zero capacity.
+    */
+
+void debug_rec_write(const char */*text*/, size_t /*len*/);
+   /*
+    * Copies text already formatted for output to the flight recorder.
+    */
+
+/* Implemented by DebugLimit.c */
+
+bool debug_limit_check(const char */*format*/, va_list /*arg*/,
+                       bool /*newline*/, unsigned long */*repeated*/,
+                       unsigned long */*suppressed*/);
+   /*
+    * Decides whether to output a string constructed from the format string
+    * and variadic arguments (and a line feed, if 'newline' is true). Gets
+    * the number of times that the previous line was repeated, if this
+    * message ends a run of repeated lines, and the number of messages from
+    * the same call site suppressed by the rate limit since it last output
+    * anything. Both should be reported before the message.
+    * Returns: false if the message should be suppressed.
+    */
+
+unsigned long debug_limit_flush(bool /*wait*/);
+   /*
+    * Ends any run of repeated lines, e.g. before closing an output. If
+    * 'wait' is false and another thread is checking a message then the run
+    * isn't ended and 0 is returned.
+    * Returns: the number of times that the last line was repeated.
+    */
+
+/* Implemented by DebugLine.c */
+
+void debug_line_vprintf(_Optional DebugLineSink */*sink*/,
+                        const char */*format*/, va_list /*arg*/,
+                        bool /*newline*/);
+   /*
+    * Appends a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to the calling
+    * thread's line buffer, and then passes any complete lines to the given
+    * function (or the one registered by debug_set_line_sink, if null).
+    */
+
+void debug_line_write(_Optional DebugLineSink */*sink*/,
+                      const char */*text*/, size_t /*len*/);
+   /*
+    * Appends 'len' characters of preformatted text to the calling thread's
+    * line buffer, and then passes any complete lines to the given function
+    * (or the one registered by debug_set_line_sink, if null).
+    */
+
+/* Implemented by DebugKV.c */
+
+size_t debug_kv_format(char */*buffer*/, size_t /*size*/,
+                       const char */*event*/, const DebugKV */*pairs*/,
+                       size_t /*count*/);
+   /*
+    * Formats an event name and an array of 'count' key/value pairs as a
+    * JSON object (without a line feed). Like snprintf, at most 'size'
+    * characters including a string terminator are written to the buffer.
+    * Returns: the length of the whole text, which was truncated if it is
+    *          not less than 'size'.
+    */
+
+size_t debug_kv_quote(char */*buffer*/, size_t /*size*/,
+                      const char */*text*/, size_t /*len*/);
+   /*
+    * Formats 'len' characters of text as a JSON string, with quotation
+    * marks and any escape sequences needed. Like snprintf, at most 'size'
+    * characters including a string terminator are written to the buffer.
+    * Returns: the length of the whole string, which was truncated if it is
+    *          not less than 'size'.
+    */
+
+/* Implemented by DebugStamp.c */
+
+bool debug_stamp_take(DebugStamp */*stamp*/, const char */*format*/,
+                      bool /*newline*/);
+   /*
+    * Notes whether output using the given format string (and a line feed,
+    * if 'newline' is true) ends a line, and gets the prefix for it if it
+    * starts a line and prefixes are enabled.
+    * Returns: true if the output should be prefixed.
+    */
+
+size_t debug_stamp_format(char */*buffer*/, size_t /*size*/,
+                          const DebugStamp */*stamp*/);
+   /*
+    * Formats the prefix for a line of output into a buffer of 'size'
+    * characters, truncating it if necessary.
+    * Returns: the number of characters written, excluding the terminator.
+    */
+
+unsigned long debug_stamp_thread(void);
+   /*
+    * Gets the number assigned to the calling thread, as shown in line
+    * prefixes. Threads are numbered from 1 in the order in which they
+    * first ask for their number.
+    */
+
+/* Implemented by DebugRot.c */
+
+bool debug_rot_open(const char */*path*/);
+   /*
+    * Opens a log file that will be rotated when it exceeds the size set by
+    * debug_set_rotation, and starts a background thread to do so.
+    * Returns: false if rotation isn't enabled or supported, or the file
+    *          couldn't be opened.
+    */
+
+void debug_rot_close(void);
+   /*
+    * Finishes any rotation in progress, stops the background thread and
+    * closes the log file opened by debug_rot_open, if any.
+    */
+
+bool debug_rot_vprintf(const char */*format*/, va_list /*arg*/,
+                       bool /*newline*/);
+   /*
+    * Appends a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to the current
+    * segment of the rotating log file.
+    * Returns: false if no rotating log file is open.
+    */
+
+bool debug_rot_write(const char */*text*/, size_t /*len*/);
+   /*
+    * Appends 'len' characters of preformatted text to the current segment
+    * of the rotating log file.
+    * Returns: false if no rotating log file is open.
+    */
+
+/* Implemented by DebugSock.c */
+
+bool debug_sock_open(const char */*log_name*/);
+   /*
+    * Starts a session of output to the local datagram socket named by the
+    * environment variable CBDEBUG_SOCKET (or DEBUG_SOCKET_PATH), and a
+    * background thread to send batches of lines to it.
+    * Returns: false if sockets aren't supported or a session couldn't be
+    *          started.
+    */
+
+void debug_sock_close(void);
+   /*
+    * Sends any lines waiting to be sent, then stops the background thread
+    * and closes the socket opened by debug_sock_open, if any.
+    */
+
+void debug_sock_line(const char */*line*/, size_t /*len*/, void */*arg*/);
+   /*
+    * Adds a line (without its line feed) to the next batch to be sent to
+    * the socket. Suitable for use as a DebugLineSink.
+    */
+
+/* Implemented by DebugTrace.c */
+
+bool debug_trace_open(const char */*path*/);
+   /*
+    * Creates a trace file (replacing any existing file of the same name)
+    * to which spans and lines of text will be written as trace events.
+    * Returns: false if the file couldn't be created.
+    */
+
+void debug_trace_close(void);
+   /*
+    * Ends the array of trace events and closes the trace file opened by
+    * debug_trace_open, if any.
+    */
+
+void debug_trace_line(const char */*line*/, size_t /*len*/, void */*arg*/);
+   /*
+    * Writes a line (without its line feed) to the trace file as an instant
+    * event. Suitable for use as a DebugLineSink.
+    */
+
+/* Implemented by DebugFd.c */
+
+bool debug_fd_open(FILE */*file*/);
+   /*
+    * Starts writing complete lines destined for the given log file directly
+    * to its file descriptor, bypassing the stream's buffer. Any text already
+    * buffered by the stream is flushed first.
+    * Returns: false if direct output isn't supported on this platform.
+    */
+
+void debug_fd_close(void);
+   /*
+    * Stops writing text directly to the log file's file descriptor. Must be
+    * called before the log file is closed.
+    */
+
+bool debug_fd_vprintf(_Optional const char */*prefix*/,
+                      const char */*format*/, va_list /*arg*/,
+                      bool /*newline*/, size_t */*len*/);
+   /*
+    * Writes a prefix (if not null), a string constructed from the format
+    * string and variadic arguments, and a line feed to the log file with a
+    * single system call, if 'newline' is true. The number of characters
+    * written is output via 'len'. The arguments are never consumed.
+    * Returns: false if direct output isn't in use, the text doesn't end a
+    *          line or it couldn't be formatted, in which case the caller
+    *          should write it to the stream instead.
+    */
+
+bool debug_fd_write(const char */*text*/, size_t /*len*/);
+   /*
+    * Writes 'len' characters of preformatted text to the log file, if it
+    * ends with a line feed.
+    * Returns: false if direct output isn't in use or the text doesn't end a
+    *          line, in which case the caller should write it to the stream
+    *          instead.
+    */
+
+/* Implemented by DebugFmt.c */
+
+int debug_fmt_vsnprintf(_Optional char */*buffer*/, size_t /*size*/,
+                        const char */*format*/, va_list /*arg*/);
+   /*
+    * Equivalent to vsnprintf, but faster for format strings that only use
+    * the conversions %c, %d, %i, %u, %x, %X, %s and %% (and %p, with glibc),
+    * with simple flags, field widths and length modifiers. Other format
+    * strings are passed to vsnprintf.
+    * Returns: the number of characters that would have been written had
+    *          'size' been large enough, not counting the terminator, or a
+    *          negative value if an encoding error occurred.
+    */
+
+int debug_fmt_vfprintf(FILE */*stream*/, const char */*format*/,
+                       va_list /*arg*/, bool /*newline*/);
+   /*
+    * Writes a string constructed from the format string and variadic
+    * arguments (and a line feed, if 'newline' is true) to a stream. Short
+    * strings are formatted by debug_fmt_vsnprintf and written in one call.
+    * Returns: the number of characters written, or a negative value if an
+    *          error occurred.
+    */
+
+/* Implemented by DebugSync.c */
+
+void debug_sync_open(FILE */*file*/);
+   /*
+    * Starts a background thread to commit text written to the given log
+    * file to stable storage, so that writers needn't flush the file
+    * themselves. The file must remain open until debug_sync_close is called.
+    */
+
+void debug_sync_close(void);
+   /*
+    * Commits any uncommitted text and then stops the background thread,
+    * if any.
+    */
+
+bool debug_sync_written(size_t /*len*/);
+   /*
+    * Notes that a line of 'len' characters was written to the log file, to
+    * be committed within the configured time limit.
+    * Returns: false if group commit isn't active, in which case the caller
+    *          must flush the file itself.
+    */
+
+void debug_sync_commit(void);
+   /*
+    * Commits any uncommitted text immediately, e.g. before aborting.
+    */
+
+void debug_sync_set_limits(unsigned int /*max_ms*/, size_t /*max_bytes*/);
+   /*
+    * Sets the maximum time for which text remains uncommitted, and the
+    * amount of uncommitted text that causes an early commit.
+    */
+
+#endif /* CBDebOut_h */
@@ -0,0 +1,167 @@
+/*
+ * CBDebugLib: Portable threading and atomic operations
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* CBDebSys.h provides the minimal set of threading primitives needed by
+   the debug output engine. On POSIX hosts built with GCC or Clang these map
+   onto pthreads and the compiler's __atomic builtins. Everywhere else
+   (notably RISC OS) the library is assumed to be called from a single
+   thread, so the same operations degenerate into plain loads and stores.
+
+History:
+  CJB: 16-Oct-26: Created.
+                  Added debug_mutex_trylock.
+*/
+
+#ifndef CBDebSys_h
+#define CBDebSys_h
+
+/* ISO library headers */
+#include <stddef.h>
+#include <stdbool.h>
+
+#if defined(__GNUC__) && !defined(ACORN_C) && !defined(__riscos) && \
+    (defined(__unix__) || defined(__APPLE__))
+#define CBDEBUG_POSIX
+#endif
+
+#ifdef CBDEBUG_POSIX
+#include <pthread.h>
+
+#define THREAD_LOCAL __thread
+
+typedef pthread_mutex_t DebugMutex;
+#define DEBUG_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+
+static inline void debug_mutex_lock(DebugMutex *mutex)
+{
+  (void)pthread_mutex_lock(mutex);
+}
+
+static inline bool debug_mutex_trylock(DebugMutex *mutex)
+{
+  return pthread_mutex_trylock(mutex) == 0;
+}
+
+static inline void debug_mutex_unlock(DebugMutex *mutex)
+{
+  (void)pthread_mutex_unlock(mutex);
+}
+
+static inline size_t sync_load(const volatile size_t *p)
+{
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void sync_store(volatile size_t *p, size_t v)
+{
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline size_t sync_fetch_add(volatile size_t *p, size_t v)
+{
+  return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL);
+}
+
+static inline bool sync_cas(volatile size_t *p, size_t expected,
+                            size_t desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void *sync_load_ptr(void *const volatile *p)
+{
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline bool sync_cas_ptr(void *volatile *p, void *expected,
+                                void *desired)
+{
+  return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#else /* CBDEBUG_POSIX */
+
+#define THREAD_LOCAL
+
+typedef int DebugMutex;
+#define DEBUG_MUTEX_INIT 0
+
+static inline void debug_mutex_lock(DebugMutex *mutex)
+{
+  (void)mutex;
+}
+
+static inline bool debug_mutex_trylock(DebugMutex *mutex)
+{
+  (void)mutex;
+  return true;
+}
+
+static inline void debug_mutex_unlock(DebugMutex *mutex)
+{
+  (void)mutex;
+}
+
+static inline size_t sync_load(const volatile size_t *p)
+{
+  return *p;
+}
+
+static inline void sync_store(volatile size_t *p, size_t v)
+{
+  *p = v;
+}
+
+static inline size_t sync_fetch_add(volatile size_t *p, size_t v)
+{
+  size_t const old = *p;
+  *p = old + v;
+  return old;
+}
+
+static inline bool sync_cas(volatile size_t *p, size_t expected,
+                            size_t desired)
+{
+  if (*p != expected)
+    return false;
+
+  *p = desired;
+  return true;
+}
+
+static inline void *sync_load_ptr(void *const volatile *p)
+{
+  return *p;
+}
+
+static inline bool sync_cas_ptr(void *volatile *p, void *expected,
+                                void *desired)
+{
+  if (*p != expected)
+    return false;
+
+  *p = desired;
+  return true;
+}
+
+#endif /* CBDEBUG_POSIX */
+
+#endif /* CBDebSys_h */
@@ -34,6 +34,11 @@
                   the final null event it receives.
   CJB: 29-Nov-20: Fixed a null pointer dereference in event_poll_idle when
                   null is passed instead of an event_code address.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
+                  Structured records of events received and handlers
+                  registered or deregistered. Callers are recorded as
+                  registered sites.
+                  Polling and dispatching events are traced as spans.
 */
 
 #undef FORTIFY /* Prevent macro redirection of event_... calls to
@@ -49,6 +54,7 @@
 #include "wimplib.h"
 
 /* Local headers */
+#define DEBUG_CATEGORY DebugCategory_PseudoEvnt
 #include "Debug.h"
 #include "Internal/CBDebMisc.h"
 #include "PseudoEvnt.h"
@@ -150,9 +156,15 @@ static void print_event(int event_code, WimpPollBlock *poll_block)
     case Wimp_EUserMessageRecorded:
       DEBUGF("Wimp message event 0x%x action code 0x%x\n",
              event_code, poll_block->user_message.hdr.action_code);
+      DEBUG_KV("wimp_message", DEBUG_KV_INT("event_code", event_code),
+               DEBUG_KV_INT("action_code",
+                            poll_block->user_message.hdr.action_code));
       break;
     case Wimp_EToolboxEvent:
       DEBUGF("Toolbox event 0x%x\n", tb->hdr.event_code);
+      DEBUG_KV("toolbox_event", DEBUG_KV_INT("event_code", tb->hdr.event_code),
+               DEBUG_KV_UINT("object_id", client_block != NULL ?
+                                          (unsigned)client_block->self_id : 0));
       switch (tb->hdr.event_code)
       {
         case Toolbox_ObjectAutoCreated:
@@ -167,6 +179,7 @@ static void print_event(int event_code, WimpPollBlock *poll_block)
       break;
     default:
       DEBUGF("Wimp event 0x%x\n", event_code);
+      DEBUG_KV("wimp_event", DEBUG_KV_INT("event_code", event_code));
       break;
   }
 }
@@ -187,7 +200,10 @@ _kernel_oserror *pseudo_event_poll(int *event_code, WimpPollBlock *poll_block, v
     {
       event_code = &ec;
     }
+    /* Handlers are dispatched by the event library before it returns */
+    DEBUG_TRACE_BEGIN("event_poll");
     e = event_poll(event_code, poll_block, poll_word);
+    DEBUG_TRACE_END("event_poll");
     if (e != NULL)
     {
       DEBUGF("event_poll error: 0x%x %s\n", e->errnum, e->errmess);
@@ -228,7 +244,9 @@ _kernel_oserror *pseudo_event_wait_for_idle(void)
       else if (event_code != Wimp_ENull)
       {
         print_event(event_code, &poll_block);
+        DEBUG_TRACE_BEGIN("event_dispatch");
         e = event_dispatch(event_code, &poll_block);
+        DEBUG_TRACE_END("event_dispatch");
         if (e != NULL)
         {
           DEBUGF("event_dispatch error: 0x%x %s\n", e->errnum, e->errmess);
@@ -256,7 +274,9 @@ _kernel_oserror *pseudo_event_poll_idle(int *event_code, WimpPollBlock *poll_blo
     {
       event_code = &ec;
     }
+    DEBUG_TRACE_BEGIN("event_poll_idle");
     e = event_poll_idle(event_code, poll_block, earliest, poll_word);
+    DEBUG_TRACE_END("event_poll_idle");
     if (e != NULL)
     {
       DEBUGF("event_poll_idle error: 0x%x %s\n", e->errnum, e->errmess);
@@ -276,6 +296,9 @@ _kernel_oserror *pseudo_event_register_toolbox_handler(ObjectId object_id, int e
   PseudoEvent_Toolbox_Handler *record;
 
   DEBUGF("event_register_toolbox_handler called for event 0x%x on object 0x%x at %s:%lu\n", event_code, (unsigned)object_id, file, line);
+  DEBUG_KV("register_toolbox_handler", DEBUG_KV_INT("event_code", event_code),
+           DEBUG_KV_UINT("object_id", (unsigned)object_id),
+           DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
 
   record = Fortify_malloc(sizeof(*record), file, line);
   if (record != NULL)
@@ -324,6 +347,9 @@ _kernel_oserror *pseudo_event_deregister_toolbox_handler(ObjectId object_id, int
   LinkedListItem *item;
 
   DEBUGF("event_deregister_toolbox_handler called for event 0x%x on object 0x%x at %s:%lu\n", event_code, (unsigned)object_id, file, line);
+  DEBUG_KV("deregister_toolbox_handler", DEBUG_KV_INT("event_code", event_code),
+           DEBUG_KV_UINT("object_id", (unsigned)object_id),
+           DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
 
   to_match.object_id = object_id;
   to_match.event_code = event_code;
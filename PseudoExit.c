@@ -19,6 +19,7 @@
 
 /* History:
   CJB: 25-May-15: Created this source file.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
 */
 
 #undef FORTIFY /* Prevent macro redirection of exit calls to
@@ -31,6 +32,7 @@
 #include <string.h>
 
 /* Local headers */
+#define DEBUG_CATEGORY DebugCategory_PseudoExit
 #include "Debug.h"
 #include "PseudoExit.h"
 
@@ -47,11 +47,27 @@
   CJB: 03-Apr-21: More data in debugging output.
   CJB: 17-Jun-23: Annotated unused variables to suppress warnings when
                   debug output is disabled at compile time.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
+                  Sample calls to PseudoFlex_size instead of only
+                  reporting them in verbose builds.
+                  Structured records of allocations, resizing, reanchoring
+                  and freeing. Callers are recorded as registered sites.
+                  The contents of each block are dumped when it is freed,
+                  at DebugLevel_Data.
+                  Allocating and resizing blocks are traced as spans.
+                  Records are found by hashing the address of the anchor
+                  instead of searching a linked list.
+                  Only the first 64 bytes of a block are dumped when it is
+                  freed. A record is no longer discarded when its anchor is
+                  reused without freeing its block.
 */
 
 /* ISO library headers */
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 /* Acorn C/C++ library headers */
 #include "flex.h"
@@ -59,8 +75,8 @@
 /* Local headers */
 #include "PseudoFlex.h"
 #include "Internal/CBDebMisc.h"
+#define DEBUG_CATEGORY DebugCategory_PseudoFlex
 #include "Debug.h"
-#include "LinkedList.h"
 
 #include "fortify.h"
 
@@ -71,19 +87,34 @@
 /* The following structure stores information about a flex block */
 typedef struct PseudoFlexRecord
 {
-  LinkedListItem           list_item;
   int                      size; /* the current size of this block, in bytes */
   flex_ptr                 anchor; /* pointer to anchor of the heap block */
+  struct PseudoFlexRecord *hidden; /* older record with the same anchor */
 }
 PseudoFlexRecord;
 
+/* Records are stored in an open-addressing hash table keyed by the address
+   of their anchor, which is never more than half full. Collisions are
+   resolved by linear probing, and removing a record moves any later records
+   in the same run back into the gap, so that no tombstones are needed.
+   If an anchor is reused without freeing its block then the new record
+   hides the old one until it is removed, as a stack would. */
+enum
+{
+  BlockTableSizeMin = 64, /* must be a power of two */
+  HexDumpMax = 64 /* bytes of a block to dump when it is freed */
+};
+
 static int defer_compact = 0; /* compact on frees */
 static int budge_state = 0; /* refuse to budge */
-static LinkedList block_list;
+static PseudoFlexRecord **block_table;
+static size_t block_table_size, block_count;
 
 /* ----------------------------------------------------------------------- */
 /*                       Function prototypes                               */
 
+static bool add_record(PseudoFlexRecord *pfr);
+static void remove_record(PseudoFlexRecord *pfr);
 static PseudoFlexRecord *find_anchor(flex_ptr anchor);
 
 /* -----------------------------------------------------------------------
@@ -92,6 +123,7 @@ static PseudoFlexRecord *find_anchor(flex_ptr anchor);
 
 int PseudoFlex_alloc(flex_ptr anchor, int n, const char *file, unsigned long line)
 {
+  DEBUG_TRACE_BEGIN("flex_alloc");
   assert(anchor != NULL);
   assert(n >= 0);
 
@@ -100,6 +132,7 @@ int PseudoFlex_alloc(flex_ptr anchor, int n, const char *file, unsigned long lin
   if (pfr == NULL)
   {
     DEBUG("PseudoFlex: Memory allocation failed! (1)");
+    DEBUG_TRACE_END("flex_alloc");
     return 0; /* failure */
   }
 
@@ -112,6 +145,7 @@ int PseudoFlex_alloc(flex_ptr anchor, int n, const char *file, unsigned long lin
   {
     free(pfr);
     DEBUG("PseudoFlex: Memory allocation failed! (2)");
+    DEBUG_TRACE_END("flex_alloc");
     return 0; /* failure */
   }
 
@@ -119,14 +153,25 @@ int PseudoFlex_alloc(flex_ptr anchor, int n, const char *file, unsigned long lin
   pfr->anchor = anchor;
   pfr->size = n;
 
-  /* Link our record of the new block at the head of a double-linked list */
-  linkedlist_insert(&block_list, NULL, &pfr->list_item);
+  /* Add our record of the new block to the hash table */
+  if (!add_record(pfr))
+  {
+    Fortify_free(blk, file, line);
+    free(pfr);
+    DEBUG("PseudoFlex: Memory allocation failed! (3)");
+    DEBUG_TRACE_END("flex_alloc");
+    return 0; /* failure */
+  }
 
   /* Store the address of the heap block in the caller's anchor */
   *anchor = blk;
   DEBUG("PseudoFlex: Allocated block %p of %d bytes anchored at %p",
     *anchor, n, (void *)anchor);
+  DEBUG_KV("flex_alloc", DEBUG_KV_PTR("anchor", anchor),
+           DEBUG_KV_PTR("block", blk), DEBUG_KV_INT("size", n),
+           DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
 
+  DEBUG_TRACE_END("flex_alloc");
   return 1; /* success */
 }
 
@@ -136,15 +181,21 @@ void PseudoFlex_free(flex_ptr anchor, const char *file, unsigned long line)
 {
   assert(anchor != NULL);
   DEBUG("PseudoFlex: Free block %p anchored at %p", *anchor, (void *)anchor);
+  DEBUG_KV("flex_free", DEBUG_KV_PTR("anchor", anchor),
+           DEBUG_KV_PTR("block", *anchor),
+           DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
 
-  /* Search our linked list of allocated block records for one which describes
+  /* Search our table of allocated block records for one which describes
      the specified flex anchor */
   PseudoFlexRecord *const pfr = find_anchor(anchor);
   assert(pfr != NULL);
   if (pfr != NULL)
   {
-    /* Remove our record of the heap block from our double-linked list */
-    linkedlist_remove(&block_list, &pfr->list_item);
+    DEBUG_LOG_HEXDUMP(DEBUG_CATEGORY, DebugLevel_Data, *anchor,
+                      LOWEST((size_t)pfr->size, (size_t)HexDumpMax));
+
+    /* Remove our record of the heap block from the hash table */
+    remove_record(pfr);
 
     /* Destroy our record of the heap block */
     free(pfr);
@@ -160,9 +211,9 @@ void PseudoFlex_free(flex_ptr anchor, const char *file, unsigned long line)
 int PseudoFlex_size(flex_ptr anchor)
 {
   assert(anchor != NULL);
-  DEBUG_VERBOSE("PseudoFlex: Get size of block %p anchored at %p", *anchor, (void *)anchor);
+  DEBUG_SAMPLED(1000, "PseudoFlex: Get size of block %p anchored at %p", *anchor, (void *)anchor);
 
-  /* Search our linked list of allocated block records for one which describes
+  /* Search our table of allocated block records for one which describes
      the specified flex anchor */
   PseudoFlexRecord *const pfr = find_anchor(anchor);
   assert(pfr != NULL);
@@ -181,10 +232,11 @@ int PseudoFlex_size(flex_ptr anchor)
 
 int PseudoFlex_extend(flex_ptr anchor, int newsize, const char *file, unsigned long line)
 {
+  DEBUG_TRACE_BEGIN("flex_extend");
   assert(anchor != NULL);
   assert(newsize >= 0);
 
-  /* Search our linked list of allocated block records for one which describes
+  /* Search our table of allocated block records for one which describes
      the specified flex anchor */
   PseudoFlexRecord *const pfr = find_anchor(anchor);
   assert(pfr != NULL);
@@ -199,15 +251,21 @@ int PseudoFlex_extend(flex_ptr anchor, int newsize, const char *file, unsigned l
       /* Update the anchor to point at the resized heap block */
       DEBUG("PseudoFlex: Resized block %p anchored at %p to %d bytes, new address %p",
             *anchor, (void *)anchor, newsize, new_addr);
+      DEBUG_KV("flex_extend", DEBUG_KV_PTR("anchor", anchor),
+               DEBUG_KV_PTR("block", *anchor), DEBUG_KV_PTR("new_block", new_addr),
+               DEBUG_KV_INT("size", newsize),
+               DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
       *anchor = new_addr;
 
       /* Update our record of the current block size */
       pfr->size = newsize;
 
+      DEBUG_TRACE_END("flex_extend");
       return 1; /* success */
     }
     DEBUG("PseudoFlex: Failed to resize heap block!");
   }
+  DEBUG_TRACE_END("flex_extend");
   return 0; /* failure */
 }
 
@@ -215,10 +273,11 @@ int PseudoFlex_extend(flex_ptr anchor, int newsize, const char *file, unsigned l
 
 int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsigned long line)
 {
+  DEBUG_TRACE_BEGIN("flex_midextend");
   assert(anchor != NULL);
   assert(at >= 0);
 
-  /* Search our linked list of allocated block records for one which describes
+  /* Search our table of allocated block records for one which describes
      the specified flex anchor */
   PseudoFlexRecord *const pfr = find_anchor(anchor);
   assert(pfr != NULL);
@@ -240,6 +299,7 @@ int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsi
       if (-by > at)
       {
         DEBUG("PseudoFlex: Can't truncate beyond start of block!");
+        DEBUG_TRACE_END("flex_midextend");
         return 0; /* failure */
       }
 
@@ -249,6 +309,7 @@ int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsi
       if (new_addr == NULL)
       {
         DEBUG("PseudoFlex: Failed to allocate replacement heap block!");
+        DEBUG_TRACE_END("flex_midextend");
         return 0; /* failure */
       }
       DEBUG_VERBOSE("PseudoFlex: New address of heap block is %p", new_addr);
@@ -273,6 +334,7 @@ int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsi
       if (new_addr == NULL)
       {
         DEBUG("PseudoFlex: Failed to resize heap block!");
+        DEBUG_TRACE_END("flex_midextend");
         return 0; /* failure */
       }
       DEBUG_VERBOSE("PseudoFlex: New address of heap block is %p", new_addr);
@@ -286,6 +348,11 @@ int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsi
     DEBUG("PseudoFlex: Extended/truncated block %p anchored at %p, "
           "by %d bytes at offset %d, new address %p", *anchor, (void *)anchor,
           by, at, new_addr);
+    DEBUG_KV("flex_midextend", DEBUG_KV_PTR("anchor", anchor),
+             DEBUG_KV_PTR("block", *anchor), DEBUG_KV_PTR("new_block", new_addr),
+             DEBUG_KV_INT("at", at), DEBUG_KV_INT("by", by),
+             DEBUG_KV_INT("size", newsize),
+             DEBUG_KV_SITE("site", debug_site_intern(file, line, NULL)));
 
     /* Update the anchor to point at the resized heap block */
     *anchor = new_addr;
@@ -293,8 +360,10 @@ int PseudoFlex_midextend(flex_ptr anchor, int at, int by, const char *file, unsi
     /* Update our record of the current block size */
     pfr->size = newsize;
 
+    DEBUG_TRACE_END("flex_midextend");
     return 1; /* success */
   }
+  DEBUG_TRACE_END("flex_midextend");
   return 0; /* failure */
 }
 
@@ -305,17 +374,29 @@ int PseudoFlex_reanchor(flex_ptr to, flex_ptr from)
   assert(from != NULL);
   assert(to != NULL);
 
-  /* Search our linked list of allocated block records for one which describes
+  /* Search our table of allocated block records for one which describes
      the specified flex anchor */
   PseudoFlexRecord *const pfr = find_anchor(from);
   assert(pfr != NULL);
   if (pfr != NULL) {
     /* Store the address of the new anchor for the flex block, so that we will
        be able to find our record again using only the new anchor. */
+    remove_record(pfr);
     pfr->anchor = to;
+    if (!add_record(pfr))
+    {
+      /* The table needed to grow because removing the record revealed
+         another with the old anchor, so putting it back can't fail */
+      pfr->anchor = from;
+      (void)add_record(pfr);
+      DEBUG("PseudoFlex: Memory allocation failed! (4)");
+      return 0; /* failure */
+    }
 
     DEBUG("PseudoFlex: Reanchored block %p from %p to %p", *from,
           (void *)from, (void *)to);
+    DEBUG_KV("flex_reanchor", DEBUG_KV_PTR("anchor", from),
+             DEBUG_KV_PTR("block", *from), DEBUG_KV_PTR("new_anchor", to));
 
     *to = *from; /* copy the heap block pointer from old anchor to new */
     *from = NULL; /* prevent reuse of old anchor */
@@ -399,23 +480,130 @@ int PseudoFlex_set_deferred_compaction(int newstate)
 /* ----------------------------------------------------------------------- */
 /*                         Private functions                               */
 
-static bool block_has_anchor(LinkedList *list, LinkedListItem *item, void *arg)
+static size_t hash_anchor(flex_ptr anchor, size_t size)
+{
+  uintptr_t const h = (uintptr_t)anchor;
+  return (size_t)((h >> 3) ^ (h >> 11)) & (size - 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t find_slot(flex_ptr anchor)
 {
-  const flex_ptr anchor = arg;
-  const PseudoFlexRecord * const pfr = (PseudoFlexRecord *)item;
+  /* Find the slot that holds the record for an anchor, or the empty slot
+     at which the search ended */
+  assert(block_table != NULL);
+  size_t i = hash_anchor(anchor, block_table_size);
+  while (block_table[i] != NULL && block_table[i]->anchor != anchor)
+    i = (i + 1) & (block_table_size - 1);
+
+  return i;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool grow_block_table(void)
+{
+  size_t const new_size = block_table_size ? block_table_size * 2
+                                           : (size_t)BlockTableSizeMin;
+  PseudoFlexRecord **const new_table = calloc(new_size, sizeof(*new_table));
+  if (new_table == NULL)
+    return false;
+
+  for (size_t i = 0; i < block_table_size; ++i)
+  {
+    PseudoFlexRecord *const pfr = block_table[i];
+    if (pfr == NULL)
+      continue;
+
+    size_t j = hash_anchor(pfr->anchor, new_size);
+    while (new_table[j] != NULL)
+      j = (j + 1) & (new_size - 1);
+    new_table[j] = pfr;
+  }
+
+  free(block_table);
+  block_table = new_table;
+  block_table_size = new_size;
+  return true;
+}
 
+/* ----------------------------------------------------------------------- */
+
+static bool add_record(PseudoFlexRecord *pfr)
+{
   assert(pfr != NULL);
-  assert(anchor != NULL);
-  NOT_USED(list);
-  return (pfr->anchor == anchor);
+
+  if (block_table == NULL && !grow_block_table())
+    return false;
+
+  /* Only a record for a new anchor needs an empty slot */
+  size_t i = find_slot(pfr->anchor);
+  if (block_table[i] == NULL && block_count >= block_table_size / 2)
+  {
+    if (!grow_block_table())
+      return false;
+
+    i = find_slot(pfr->anchor);
+  }
+
+  pfr->hidden = block_table[i];
+  if (pfr->hidden != NULL)
+  {
+    /* The anchor was reused without freeing its block. Only the newest
+       block can be found by its anchor until that is freed or reanchored,
+       but the old record is kept so that it can be found again after. */
+    DEBUG("PseudoFlex: Anchor %p reused without freeing block %p!",
+          (void *)pfr->anchor, *pfr->anchor);
+  }
+  else
+  {
+    block_count++;
+  }
+  block_table[i] = pfr;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void remove_record(PseudoFlexRecord *pfr)
+{
+  assert(pfr != NULL);
+
+  size_t i = find_slot(pfr->anchor);
+  assert(block_table[i] == pfr);
+  if (pfr->hidden != NULL)
+  {
+    /* Reveal the record that the removed record was hiding */
+    block_table[i] = pfr->hidden;
+    return;
+  }
+
+  size_t const mask = block_table_size - 1;
+
+  /* Move back any later record in the same run that would otherwise become
+     unreachable because its probe sequence passes through the gap */
+  for (size_t j = (i + 1) & mask; block_table[j] != NULL; j = (j + 1) & mask)
+  {
+    size_t const home = hash_anchor(block_table[j]->anchor,
+                                    block_table_size);
+    if (((j - home) & mask) >= ((j - i) & mask))
+    {
+      block_table[i] = block_table[j];
+      i = j;
+    }
+  }
+
+  block_table[i] = NULL;
+  block_count--;
 }
 
 /* ----------------------------------------------------------------------- */
 
 static PseudoFlexRecord *find_anchor(flex_ptr anchor)
 {
-  PseudoFlexRecord *const pfr = (PseudoFlexRecord *)linkedlist_for_each(
-           &block_list, block_has_anchor, anchor);
+  PseudoFlexRecord *const pfr = block_table != NULL ?
+                                block_table[find_slot(anchor)] : NULL;
   if (pfr == NULL)
   {
     DEBUG("PseudoFlex: Anchor %p not found!", (void *)anchor);
@@ -24,6 +24,7 @@
   CJB: 09-Dec-16: Added interceptor versions of fgetc and fputc.
   CJB: 13-Jun-20: Use new Fortify_AllowAllocate to avoid accumulating huge
                   numbers of 'freed' dummy memory allocations.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
 */
 
 #undef FORTIFY /* Prevent macro redirection of IO function calls to
@@ -35,6 +36,7 @@
 #include <errno.h>
 
 /* Local headers */
+#define DEBUG_CATEGORY DebugCategory_PseudoIO
 #include "Debug.h"
 #include "Internal/CBDebMisc.h"
 #include "PseudoIO.h"
@@ -23,6 +23,10 @@
   CJB: 18-Apr-15: Assertions are now provided by debug.h.
   CJB: 13-Jun-20: Use new Fortify_AllowAllocate to avoid accumulating huge
                   numbers of 'freed' dummy memory allocations.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
+                  Sampled debugging output from pseudokern_fail.
+                  Report the first simulated failure at each call site
+                  instead of only the first overall.
 */
 
 #undef FORTIFY /* Prevent macro redirection of _kernel_... calls to
@@ -37,6 +41,7 @@
 /* Local headers */
 #include "PseudoKern.h"
 #include "Internal/CBDebMisc.h"
+#define DEBUG_CATEGORY DebugCategory_PseudoKern
 #include "Debug.h"
 
 #include "fortify.h"
@@ -45,10 +50,24 @@ _kernel_oserror *pseudokern_fail(const char *file, unsigned long line)
 {
   _kernel_oserror *e = NULL;
 
+  DEBUG_SAMPLED(100, "pseudokern_fail called from %s:%lu", file, line);
+
   /* CJB's extra Fortify function to avoid accumulating
      huge numbers of 'freed' dummy memory allocations. */
   if (!Fortify_AllowAllocate(file, line))
   {
+#ifdef DEBUG_OUTPUT
+    /* Count simulated failures at each call site, in a table indexed by
+       the site's registered identifier */
+    static unsigned long failures[DEBUG_SITE_ID_MAX];
+    DebugSiteId const id = debug_site_intern(file, line, NULL);
+    if (id != 0 && failures[id - 1]++ == 0)
+    {
+      DEBUGFL("pseudokern_fail: first simulated failure at %s:%lu",
+              file, line);
+    }
+#endif
+
     /* Look up a generic out-of-memory error. Note that this also takes
        care of setting _kernel_last_oserror. */
     static const _kernel_oserror temp = {DUMMY_ERRNO, "NoMem"};
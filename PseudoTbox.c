@@ -45,6 +45,9 @@
                   More debugging output from other functions.
   CJB: 17-Jun-23: Annotated unused variables to suppress warnings when
                   debug output is disabled at compile time.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
+                  The contents of buffers passed to saveas_buffer_filled are
+                  dumped at DebugLevel_Data.
 */
 
 #undef FORTIFY /* Prevent macro redirection of toolbox_... calls to
@@ -78,6 +81,7 @@
 #include "PseudoTbox.h"
 #include "PseudoKern.h"
 #include "LinkedList.h"
+#define DEBUG_CATEGORY DebugCategory_PseudoTbox
 #include "Debug.h"
 
 /* This list of objects is currently used only to detect leaks */
@@ -458,6 +462,8 @@ _kernel_oserror *pseudo_saveas_buffer_filled(unsigned int flags, ObjectId saveas
 {
   DEBUGF("saveas_buffer_filled called with flags 0x%x, object 0x%x, buffer %p, bytes %d at %s:%lu\n",
          flags, (unsigned)saveas, buffer, bytes_written, file, line);
+  DEBUG_LOG_HEXDUMP(DEBUG_CATEGORY, DebugLevel_Data, buffer,
+                    bytes_written > 0 ? (size_t)bytes_written : 0);
 
   /* It's not clear how fill buffer event handlers are meant to handle
      errors. Record the parameters anyway for consistency with
@@ -50,6 +50,10 @@
                   debug output is disabled at compile time.
   CJB: 02-Aug-26: Explicitly allow output arguments of pseudo_wimp_get_message2
                   to be null.
+  CJB: 16-Oct-26: Debugging output is assigned to its own category.
+                  Recorded and queried Wimp messages are output by
+                  DEBUG_HEXDUMP instead of six separate conversions.
+                  Redraw loops are traced as spans.
 */
 
 #undef FORTIFY /* Prevent macro redirection of wimp_... calls to
@@ -66,6 +70,7 @@
 #include "wimplib.h"
 
 /* Local headers */
+#define DEBUG_CATEGORY DebugCategory_PseudoWimp
 #include "Debug.h"
 #include "PseudoWimp.h"
 #include "PseudoKern.h"
@@ -73,7 +78,8 @@
 
 enum
 {
-   TaskHandleAndVersion = 5
+   TaskHandleAndVersion = 5,
+   DumpSize = 6 * sizeof(int) /* first six words of each message */
 };
 
 static bool capture;
@@ -137,14 +143,8 @@ void pseudo_wimp_get_message(unsigned int index, WimpMessage *msg)
 {
   assert(index < msg_count);
 
-  DEBUGF("Wimp message %u of %zu {0x%x,0x%x,0x%x,0x%x,0x%x,0x%x} queried\n",
-         index+1, msg_count,
-         msgs[index].block.words[0],
-         msgs[index].block.words[1],
-         msgs[index].block.words[2],
-         msgs[index].block.words[3],
-         msgs[index].block.words[4],
-         msgs[index].block.words[5]);
+  DEBUGF("Wimp message %u of %zu queried\n", index+1, msg_count);
+  DEBUG_HEXDUMP(&msgs[index].block, DumpSize);
 
   assert(msg);
   *msg = msgs[index].block.user_message;
@@ -156,14 +156,8 @@ void pseudo_wimp_get_message2(unsigned int index, _Optional int *code,
 {
   assert(index < msg_count);
 
-  DEBUGF("Wimp message %u of %zu {0x%x,0x%x,0x%x,0x%x,0x%x,0x%x} queried\n",
-         index+1, msg_count,
-         msgs[index].block.words[0],
-         msgs[index].block.words[1],
-         msgs[index].block.words[2],
-         msgs[index].block.words[3],
-         msgs[index].block.words[4],
-         msgs[index].block.words[5]);
+  DEBUGF("Wimp message %u of %zu queried\n", index+1, msg_count);
+  DEBUG_HEXDUMP(&msgs[index].block, DumpSize);
 
   if (code)
     *code = msgs[index].code;
@@ -235,14 +229,8 @@ _kernel_oserror *pseudo_wimp_send_message(int code, void *block, int handle, int
         msgs[msg_count].block = *(const WimpPollBlock *)block;
         msgs[msg_count].handle = handle;
         msgs[msg_count].icon = icon;
-        DEBUGF("Wimp message %zu {0x%x,0x%x,0x%x,0x%x,0x%x,0x%x} recorded\n",
-               msg_count+1,
-               msgs[msg_count].block.words[0],
-               msgs[msg_count].block.words[1],
-               msgs[msg_count].block.words[2],
-               msgs[msg_count].block.words[3],
-               msgs[msg_count].block.words[4],
-               msgs[msg_count].block.words[5]);
+        DEBUGF("Wimp message %zu recorded\n", msg_count+1);
+        DEBUG_HEXDUMP(&msgs[msg_count].block, DumpSize);
         msg_count++;
       }
     }
@@ -329,6 +317,7 @@ _kernel_oserror *pseudo_wimp_redraw_window(WimpRedrawWindowBlock *block, int *mo
 
   assert(block);
   /* more can be NULL */
+  DEBUG_TRACE_BEGIN("redraw");
   if (e == NULL)
   {
     e = wimp_redraw_window(block, more);
@@ -348,6 +337,10 @@ _kernel_oserror *pseudo_wimp_redraw_window(WimpRedrawWindowBlock *block, int *mo
     }
   }
 
+  /* The span ends with the last rectangle, which may be the first */
+  if (e != NULL || more == NULL || *more == 0)
+    DEBUG_TRACE_END("redraw");
+
   return e;
 }
 
@@ -376,6 +369,9 @@ _kernel_oserror *pseudo_wimp_get_rectangle(WimpRedrawWindowBlock *block, int *mo
     }
   }
 
+  if (e != NULL || more == NULL || *more == 0)
+    DEBUG_TRACE_END("redraw");
+
   return e;
 }
 
@@ -0,0 +1,389 @@
+/*
+ * CBDebugLib: Measure the throughput and latency of debugging output
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Usage: debugbench [iterations [output]]
+   Calls each output function the given number of times per thread (default
+   1000) in every output mode that can be used on this platform, for a range
+   of message sizes and thread counts. Results are written to a file (or
+   standard output) as comma-separated values, one row per combination:
+     mode,function,size,threads,calls_per_sec,p50_ns,p99_ns,max_ns
+   Output written to the standard streams by the library is discarded, so
+   that only the cost of producing it is measured. Files written by the
+   library are deleted afterwards.
+
+History:
+  CJB: 16-Oct-26: Created this source file.
+                  Worker threads are released by a gate instead of a
+                  barrier, so that they can be cancelled if another thread
+                  can't be created.
+*/
+
+/* Needed for dup and clock_gettime in strict ISO C mode */
+#define _XOPEN_SOURCE 700
+
+/* ISO library headers */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* POSIX headers */
+#include <unistd.h>
+#include <pthread.h>
+
+/* Local headers */
+#include "Debug.h"
+
+enum
+{
+  IterationsDefault = 1000,
+  MaxThreads = 8,
+  MaxMessageSize = 1024
+};
+
+typedef enum
+{
+  Function_Printf,
+  Function_Printfl,
+  Function_VPrintf,
+  Function_LAST
+}
+Function;
+
+/* Worker threads wait at a gate until all of them have been created */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool open;
+  bool cancelled;
+}
+StartGate;
+
+typedef struct
+{
+  Function function;
+  int size;
+  unsigned long iterations;
+  StartGate *gate;
+  unsigned long long *samples; /* latency of each call, in nanoseconds */
+  unsigned long long start, end;
+}
+Worker;
+
+static const struct
+{
+  DebugOutput mode;
+  const char *name;
+}
+modes[] =
+{
+  { DebugOutput_None, "None" },
+#ifdef DEBUG_OUTPUT
+  /* Otherwise, debug_set_output does nothing */
+  { DebugOutput_StdOut, "StdOut" },
+  { DebugOutput_StdErr, "StdErr" },
+  { DebugOutput_File, "File" },
+  { DebugOutput_FlushedFile, "FlushedFile" },
+#endif
+};
+
+static const char *const function_names[Function_LAST] =
+{
+  "debug_printf", "debug_printfl", "debug_vprintf"
+};
+
+static const int sizes[] = { 16, 128, MaxMessageSize };
+static const int thread_counts[] = { 1, 2, 4, MaxThreads };
+
+static const char log_name[] = "DebugBench";
+static char payload[MaxMessageSize + 1];
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned long long clock_ns(void)
+{
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ull +
+         (unsigned long long)ts.tv_nsec;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void call_vprintf(const char *format, ...)
+{
+  va_list arg;
+  va_start(arg, format);
+  debug_vprintf(format, arg);
+  va_end(arg);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool wait_gate(StartGate *gate)
+{
+  (void)pthread_mutex_lock(&gate->lock);
+  while (!gate->open)
+    (void)pthread_cond_wait(&gate->cond, &gate->lock);
+
+  bool const cancelled = gate->cancelled;
+  (void)pthread_mutex_unlock(&gate->lock);
+  return !cancelled;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void open_gate(StartGate *gate, bool cancel)
+{
+  (void)pthread_mutex_lock(&gate->lock);
+  gate->open = true;
+  gate->cancelled = cancel;
+  (void)pthread_cond_broadcast(&gate->cond);
+  (void)pthread_mutex_unlock(&gate->lock);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void *worker_thread(void *arg)
+{
+  Worker *const w = arg;
+
+  /* Each message is the given size, including its line feed */
+  int const len = w->size - 7;
+
+  if (!wait_gate(w->gate))
+    return NULL; /* not all threads could be created */
+
+  w->start = clock_ns();
+
+  for (unsigned long i = 0; i < w->iterations; ++i)
+  {
+    int const n = (int)(i % 100000);
+    unsigned long long const t = clock_ns();
+
+    switch (w->function)
+    {
+      case Function_Printf:
+        debug_printf("%05d %.*s\n", n, len, payload);
+        break;
+
+      case Function_Printfl:
+        debug_printfl("%05d %.*s", n, len, payload);
+        break;
+
+      default:
+        call_vprintf("%05d %.*s\n", n, len, payload);
+        break;
+    }
+
+    w->samples[i] = clock_ns() - t;
+  }
+
+  w->end = clock_ns();
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int compare_samples(const void *a, const void *b)
+{
+  unsigned long long const x = *(const unsigned long long *)a,
+                           y = *(const unsigned long long *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool run(FILE *results, const char *mode_name, Function function,
+                int size, int nthreads, unsigned long iterations,
+                unsigned long long *samples)
+{
+  Worker workers[MaxThreads];
+  pthread_t threads[MaxThreads];
+  StartGate gate = { .open = false, .cancelled = false };
+
+  if (pthread_mutex_init(&gate.lock, NULL) != 0)
+    return false;
+
+  if (pthread_cond_init(&gate.cond, NULL) != 0)
+  {
+    (void)pthread_mutex_destroy(&gate.lock);
+    return false;
+  }
+
+  int started = 0;
+  for (; started < nthreads; ++started)
+  {
+    Worker *const w = &workers[started];
+    w->function = function;
+    w->size = size;
+    w->iterations = iterations;
+    w->gate = &gate;
+    w->samples = samples + (size_t)started * iterations;
+
+    if (pthread_create(&threads[started], NULL, worker_thread, w) != 0)
+      break;
+  }
+
+  /* Threads that were created must be released even if they can't all
+     be, otherwise they would never finish */
+  open_gate(&gate, started < nthreads);
+
+  for (int i = 0; i < started; ++i)
+    (void)pthread_join(threads[i], NULL);
+
+  (void)pthread_cond_destroy(&gate.cond);
+  (void)pthread_mutex_destroy(&gate.lock);
+  if (started < nthreads)
+    return false;
+
+  unsigned long long start = workers[0].start, end = workers[0].end;
+  for (int i = 1; i < nthreads; ++i)
+  {
+    if (workers[i].start < start)
+      start = workers[i].start;
+    if (workers[i].end > end)
+      end = workers[i].end;
+  }
+
+  size_t const count = (size_t)nthreads * iterations;
+  qsort(samples, count, sizeof(*samples), compare_samples);
+
+  double const secs = (double)(end - start) / 1e9;
+  fprintf(results, "%s,%s,%d,%d,%.0f,%llu,%llu,%llu\n", mode_name,
+          function_names[function], size, nthreads,
+          secs > 0 ? (double)count / secs : 0.0,
+          samples[count / 2], samples[count - 1 - count / 100],
+          samples[count - 1]);
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  unsigned long iterations = IterationsDefault;
+  FILE *results = NULL;
+
+  if (argc > 3)
+  {
+    fprintf(stderr, "Usage: %s [iterations [output]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1)
+  {
+    char *end;
+    iterations = strtoul(argv[1], &end, 10);
+    if (*end != '\0' || iterations == 0)
+    {
+      fprintf(stderr, "%s: bad iteration count '%s'\n", argv[0], argv[1]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc > 2)
+  {
+    results = fopen(argv[2], "w");
+    if (results == NULL)
+    {
+      perror(argv[2]);
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    /* Keep the standard output stream for results */
+    int const fd = dup(STDOUT_FILENO);
+    if (fd >= 0)
+      results = fdopen(fd, "w");
+
+    if (results == NULL)
+    {
+      perror(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  unsigned long long *const samples =
+    malloc(sizeof(*samples) * MaxThreads * iterations);
+
+  if (samples == NULL)
+  {
+    fprintf(stderr, "%s: not enough memory\n", argv[0]);
+    fclose(results);
+    return EXIT_FAILURE;
+  }
+
+  /* Keep the library's files in the current directory */
+  (void)debug_set_log_dir(".");
+  char file_path[sizeof(log_name) + 32];
+  sprintf(file_path, "./%s", log_name);
+
+  memset(payload, 'x', MaxMessageSize);
+
+  if (freopen("/dev/null", "w", stdout) == NULL ||
+      freopen("/dev/null", "w", stderr) == NULL)
+  {
+    fprintf(results, "Can't discard standard output\n");
+    fclose(results);
+    free(samples);
+    return EXIT_FAILURE;
+  }
+
+  fprintf(results,
+          "mode,function,size,threads,calls_per_sec,p50_ns,p99_ns,max_ns\n");
+
+  bool ok = true;
+  for (size_t m = 0; ok && m < sizeof(modes) / sizeof(modes[0]); ++m)
+  {
+    for (Function f = Function_Printf; ok && f < Function_LAST; ++f)
+    {
+      for (size_t s = 0; ok && s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+      {
+        for (size_t t = 0;
+             ok && t < sizeof(thread_counts) / sizeof(thread_counts[0]);
+             ++t)
+        {
+          (void)debug_set_output(modes[m].mode, log_name);
+
+          ok = run(results, modes[m].name, f, sizes[s], thread_counts[t],
+                   iterations, samples);
+
+          (void)debug_set_output(DebugOutput_None, "");
+          (void)remove(file_path);
+        }
+      }
+    }
+  }
+
+  free(samples);
+
+  if (!ok)
+    fprintf(results, "Failed to start threads\n");
+
+  if (fclose(results) != 0)
+    ok = false;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,82 @@
+/*
+ * CBDebugLib: Convert a binary debugging log to text
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Usage: decodelog [input [output]]
+   Reads a log file written in DebugOutput_Binary mode (or standard input)
+   and writes the equivalent text to a file (or standard output).
+
+History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Local headers */
+#include "Debug.h"
+
+int main(int argc, char *argv[])
+{
+  FILE *in = stdin, *out = stdout;
+
+  if (argc > 3)
+  {
+    fprintf(stderr, "Usage: %s [input [output]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1)
+  {
+    in = fopen(argv[1], "rb");
+    if (in == NULL)
+    {
+      perror(argv[1]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc > 2)
+  {
+    out = fopen(argv[2], "w");
+    if (out == NULL)
+    {
+      perror(argv[2]);
+      fclose(in);
+      return EXIT_FAILURE;
+    }
+  }
+
+  bool const ok = debug_bin_decode(in, out);
+  if (!ok)
+  {
+    fprintf(stderr, "%s: malformed input\n", argv[0]);
+  }
+
+  if (in != stdin)
+    fclose(in);
+
+  if (out != stdout && fclose(out) != 0)
+  {
+    perror(argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,232 @@
+/*
+ * CBDebugLib: Collect debugging output sent to a local datagram socket
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Usage: logcollect [socket [output]]
+   Binds a local datagram socket (by default, DEBUG_SOCKET_PATH) and
+   appends each line received from programs using DebugOutput_Socket mode
+   to a file (or standard output), prefixed with the log name and session
+   ID of the sender, e.g. "MyApp 1234.1: Hello". The first line of each
+   session is preceded by a line announcing the new session. Runs until
+   interrupted or terminated, then removes the socket.
+
+History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* Needed for recvmmsg and sigaction in strict ISO C mode */
+#define _GNU_SOURCE
+
+/* ISO library headers */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <signal.h>
+
+/* POSIX headers */
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/* Local headers */
+#include "Debug.h"
+
+enum
+{
+  MaxMessages = 64,      /* number of datagrams received at once */
+  MaxMessageSize = 8192 + 80,
+  MaxSessions = 64,      /* number of sessions remembered */
+  MaxSessionSize = 80
+};
+
+static volatile sig_atomic_t stopping;
+static char sessions[MaxSessions][MaxSessionSize];
+static size_t nsessions, oldest_session;
+
+/* ----------------------------------------------------------------------- */
+
+static void handle_signal(int sig)
+{
+  (void)sig;
+  stopping = 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool is_new_session(const char *header, size_t len)
+{
+  /* Remember the most recent sessions, forgetting the oldest first */
+  if (len >= MaxSessionSize)
+    len = MaxSessionSize - 1;
+
+  for (size_t i = 0; i < nsessions; ++i)
+  {
+    if (strncmp(sessions[i], header, len) == 0 && sessions[i][len] == '\0')
+      return false;
+  }
+
+  size_t const i = nsessions < MaxSessions ? nsessions++ : oldest_session++;
+  oldest_session %= MaxSessions;
+  memcpy(sessions[i], header, len);
+  sessions[i][len] = '\0';
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_message(FILE *out, const char *msg, size_t len)
+{
+  /* Each datagram is "<session ID> <log name>\t<line>" */
+  const char *const tab = memchr(msg, '\t', len);
+  const char *const space = tab ? memchr(msg, ' ', (size_t)(tab - msg)) :
+                                  NULL;
+  if (space == NULL)
+  {
+    fprintf(out, "?: %.*s\n", (int)len, msg);
+    return;
+  }
+
+  int const id_len = (int)(space - msg);
+  int const name_len = (int)(tab - space - 1);
+  const char *const line = tab + 1;
+  int const line_len = (int)(len - (size_t)(line - msg));
+
+  if (is_new_session(msg, (size_t)(tab - msg)))
+  {
+    fprintf(out, "%.*s %.*s: --- Session started ---\n", name_len, space + 1,
+            id_len, msg);
+  }
+
+  fprintf(out, "%.*s %.*s: %.*s\n", name_len, space + 1, id_len, msg,
+          line_len, line);
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  const char *path = DEBUG_SOCKET_PATH;
+  FILE *out = stdout;
+
+  if (argc > 3)
+  {
+    fprintf(stderr, "Usage: %s [socket [output]]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1)
+    path = argv[1];
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path))
+  {
+    fprintf(stderr, "%s: socket path too long\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  strcpy(address.sun_path, path);
+
+  if (argc > 2)
+  {
+    out = fopen(argv[2], "a");
+    if (out == NULL)
+    {
+      perror(argv[2]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  int const sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (sock < 0)
+  {
+    perror("socket");
+    return EXIT_FAILURE;
+  }
+
+  /* Replace any socket left behind by a previous collector */
+  (void)unlink(path);
+  if (bind(sock, (struct sockaddr *)&address, sizeof(address)) < 0)
+  {
+    perror(path);
+    close(sock);
+    return EXIT_FAILURE;
+  }
+
+  /* Signals must interrupt recvmmsg rather than restarting it */
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_signal;
+  sigemptyset(&sa.sa_mask);
+  (void)sigaction(SIGINT, &sa, NULL);
+  (void)sigaction(SIGTERM, &sa, NULL);
+
+  static char buffers[MaxMessages][MaxMessageSize];
+  struct mmsghdr msgs[MaxMessages];
+  struct iovec iov[MaxMessages];
+  int status = EXIT_SUCCESS;
+
+  while (!stopping)
+  {
+    for (size_t i = 0; i < MaxMessages; ++i)
+    {
+      iov[i].iov_base = buffers[i];
+      iov[i].iov_len = sizeof(buffers[i]);
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* Wait for at least one datagram, then take any others waiting */
+    int const n = recvmmsg(sock, msgs, MaxMessages, MSG_WAITFORONE, NULL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      perror("recvmmsg");
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    for (int i = 0; i < n; ++i)
+      write_message(out, buffers[i], msgs[i].msg_len);
+
+    if (fflush(out) != 0)
+    {
+      perror(argc > 2 ? argv[2] : "stdout");
+      status = EXIT_FAILURE;
+      break;
+    }
+  }
+
+  close(sock);
+  (void)unlink(path);
+
+  if (out != stdout && fclose(out) != 0)
+  {
+    perror(argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  return status;
+}
@@ -0,0 +1,605 @@
+/*
+ * CBDebugLib: Filter and summarise a binary debugging log
+ * Copyright (C) 2026 Christopher Bazley
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Usage: querylog [options] [input [output]]
+   Reads a log file written in DebugOutput_Binary mode (or standard input)
+   and writes the records that match all of the given filters to a file
+   (or standard output). The input is decoded one record at a time, so
+   logs of any size can be queried.
+
+   -c category  Only records in a category, given by name or number.
+   -s text      Only records whose call site (format string or event name)
+                or a string value (e.g. "file:line") contains the text.
+   -f seconds   Only records stamped at or after a time.
+   -t seconds   Only records stamped before a time.
+   -o id        Only structured records with an "anchor", "block",
+                "new_anchor" or "object_id" value equal to an identifier.
+   -F format    Output "text" (as decodelog, the default), "csv" (with
+                columns time_us, thread, category, site and text) or
+                "counts" (the number of records for each category and site,
+                most frequent first).
+
+   Time filters apply to the times in line prefixes, which are seconds
+   since prefixes were first enabled by the program that wrote the log (not
+   the time of day). A record without one is assumed to have been written
+   at the time of the previous record that had one.
+
+History:
+  CJB: 16-Oct-26: Created this source file.
+*/
+
+/* ISO library headers */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Local headers */
+#include "Debug.h"
+
+enum
+{
+  Format_Text,
+  Format_CSV,
+  Format_Counts,
+  StreamBufferSize = 1 << 20,
+  MinCountTableSize = 256
+};
+
+typedef struct
+{
+  DebugCategory category;
+  char         *site;  /* null for an empty slot */
+  size_t        count;
+}
+Count;
+
+typedef struct
+{
+  int                 format;
+  bool                any_category;
+  DebugCategory       category;
+  const char         *site;
+  bool                any_time;
+  unsigned long long  from_us;
+  unsigned long long  to_us;
+  bool                any_id;
+  unsigned long long  id;
+  FILE               *out;
+  unsigned long long  last_time_us;
+  bool                time_seen;
+  Count              *counts;
+  size_t              counts_size;
+  size_t              counts_used;
+  bool                failed;
+}
+Query;
+
+static const char *const id_keys[] =
+{
+  "anchor", "block", "new_anchor", "object_id"
+};
+
+/* ----------------------------------------------------------------------- */
+
+static bool parse_category(const char *arg, DebugCategory *category)
+{
+  for (int c = 0; c < DebugCategory_LAST; ++c)
+  {
+    const char *const name = debug_get_category_name((DebugCategory)c);
+    if (name != NULL && strcmp(name, arg) == 0)
+    {
+      *category = (DebugCategory)c;
+      return true;
+    }
+  }
+
+  char *end;
+  unsigned long const n = strtoul(arg, &end, 10);
+  if (*arg == '\0' || *end != '\0' || n >= DebugCategory_LAST)
+    return false;
+
+  *category = (DebugCategory)n;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool parse_time(const char *arg, unsigned long long *time_us)
+{
+  char *end;
+  double const seconds = strtod(arg, &end);
+  if (*arg == '\0' || *end != '\0' || !(seconds >= 0.0))
+    return false;
+
+  *time_us = (unsigned long long)(seconds * 1e6);
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool has_id(const DebugLogRecord *record, unsigned long long id)
+{
+  for (size_t i = 0; i < record->count; ++i)
+  {
+    const DebugKV *const kv = &record->pairs[i];
+    unsigned long long value;
+
+    switch (kv->type)
+    {
+      case DebugKVType_Int:
+        value = (unsigned long long)kv->value.i;
+        break;
+      case DebugKVType_UInt:
+        value = kv->value.u;
+        break;
+      case DebugKVType_Ptr:
+        value = (unsigned long long)(size_t)kv->value.p;
+        break;
+      default:
+        continue;
+    }
+
+    for (size_t k = 0; k < sizeof(id_keys) / sizeof(id_keys[0]); ++k)
+    {
+      if (value == id && strcmp(kv->key, id_keys[k]) == 0)
+        return true;
+    }
+  }
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool has_site(const DebugLogRecord *record, const char *text)
+{
+  if (record->site != NULL && strstr(record->site, text) != NULL)
+    return true;
+
+  for (size_t i = 0; i < record->count; ++i)
+  {
+    const DebugKV *const kv = &record->pairs[i];
+    if (kv->type == DebugKVType_Str && kv->value.s != NULL &&
+        strstr(kv->value.s, text) != NULL)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool matches(Query *query, const DebugLogRecord *record)
+{
+  if (record->prefix & DebugPrefix_Time)
+  {
+    query->last_time_us = record->time_us;
+    query->time_seen = true;
+  }
+
+  if (!query->any_category && record->category != query->category)
+    return false;
+
+  if (!query->any_time &&
+      (!query->time_seen || query->last_time_us < query->from_us ||
+       query->last_time_us >= query->to_us))
+  {
+    return false;
+  }
+
+  if (query->site != NULL && !has_site(record, query->site))
+    return false;
+
+  if (!query->any_id && !has_id(record, query->id))
+    return false;
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_csv_field(FILE *out, const char *text, size_t len)
+{
+  /* Quote every field that contains a separator, quote or line break */
+  if (strcspn(text, ",\"\r\n") >= len)
+  {
+    (void)fwrite(text, 1, len, out);
+    return;
+  }
+
+  (void)fputc('"', out);
+  for (size_t i = 0; i < len; ++i)
+  {
+    if (text[i] == '"')
+      (void)fputc('"', out);
+    (void)fputc(text[i], out);
+  }
+  (void)fputc('"', out);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_escaped(FILE *out, const char *text)
+{
+  /* Keep each count on one line */
+  for (; *text != '\0'; ++text)
+  {
+    unsigned char const c = (unsigned char)*text;
+    if (c == '\\')
+      (void)fputs("\\\\", out);
+    else if (c == '\n')
+      (void)fputs("\\n", out);
+    else if (c == '\t')
+      (void)fputs("\\t", out);
+    else if (c < ' ' || c == 0x7f)
+      fprintf(out, "\\x%02x", c);
+    else
+      (void)fputc(c, out);
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_category(FILE *out, DebugCategory category)
+{
+  const char *const name = debug_get_category_name(category);
+  if (name != NULL)
+    (void)fputs(name, out);
+  else
+    fprintf(out, "%d", (int)category);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static size_t hash_key(DebugCategory category, const char *site)
+{
+  /* FNV-1a */
+  size_t h = (size_t)2166136261u ^ (size_t)category;
+  for (; *site != '\0'; ++site)
+  {
+    h ^= (unsigned char)*site;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool grow_counts(Query *query)
+{
+  size_t const new_size = query->counts_size ?
+                          query->counts_size * 2 : MinCountTableSize;
+  Count *const new_counts = calloc(new_size, sizeof(*new_counts));
+  if (new_counts == NULL)
+    return false;
+
+  for (size_t i = 0; i < query->counts_size; ++i)
+  {
+    Count const *const old = &query->counts[i];
+    if (old->site == NULL)
+      continue;
+
+    size_t j = hash_key(old->category, old->site) & (new_size - 1);
+    while (new_counts[j].site != NULL)
+      j = (j + 1) & (new_size - 1);
+
+    new_counts[j] = *old;
+  }
+
+  free(query->counts);
+  query->counts = new_counts;
+  query->counts_size = new_size;
+  return true;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void add_count(Query *query, DebugCategory category, const char *site)
+{
+  /* Keep the table no more than half full */
+  if (query->counts_used >= query->counts_size / 2 && !grow_counts(query))
+  {
+    query->failed = true;
+    return;
+  }
+
+  size_t const mask = query->counts_size - 1;
+  size_t i = hash_key(category, site) & mask;
+  for (; query->counts[i].site != NULL; i = (i + 1) & mask)
+  {
+    Count *const count = &query->counts[i];
+    if (count->category == category && strcmp(count->site, site) == 0)
+    {
+      ++count->count;
+      return;
+    }
+  }
+
+  /* The record's strings are only valid until the next record is read */
+  size_t const len = strlen(site) + 1;
+  char *const copy = malloc(len);
+  if (copy == NULL)
+  {
+    query->failed = true;
+    return;
+  }
+  memcpy(copy, site, len);
+
+  query->counts[i].category = category;
+  query->counts[i].site = copy;
+  query->counts[i].count = 1;
+  ++query->counts_used;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int compare_counts(const void *a, const void *b)
+{
+  /* Most frequent first, then in order of category and site */
+  const Count *const ca = a, *const cb = b;
+  if (ca->count != cb->count)
+    return ca->count < cb->count ? 1 : -1;
+
+  if (ca->category != cb->category)
+    return ca->category < cb->category ? -1 : 1;
+
+  return strcmp(ca->site, cb->site);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void write_counts(Query *query)
+{
+  /* Move the used slots to the start of the table, then sort them */
+  size_t n = 0;
+  for (size_t i = 0; i < query->counts_size; ++i)
+  {
+    if (query->counts[i].site != NULL)
+      query->counts[n++] = query->counts[i];
+  }
+
+  if (n > 0)
+    qsort(query->counts, n, sizeof(query->counts[0]), compare_counts);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    fprintf(query->out, "%zu\t", query->counts[i].count);
+    write_category(query->out, query->counts[i].category);
+    (void)fputc('\t', query->out);
+    write_escaped(query->out, query->counts[i].site);
+    (void)fputc('\n', query->out);
+    free(query->counts[i].site);
+  }
+
+  free(query->counts);
+  query->counts = NULL;
+  query->counts_size = query->counts_used = 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void query_record(const DebugLogRecord *record, void *arg)
+{
+  Query *const query = arg;
+
+  if (query->failed || !matches(query, record))
+    return;
+
+  FILE *const out = query->out;
+
+  switch (query->format)
+  {
+    case Format_Text:
+      /* Same as the prefix written in DebugOutput_File mode */
+      if (record->prefix & DebugPrefix_Time)
+      {
+        fprintf(out, "%llu.%06llu ", record->time_us / 1000000u,
+                record->time_us % 1000000u);
+      }
+      if (record->prefix & DebugPrefix_Delta)
+      {
+        fprintf(out, "+%llu.%06llu ", record->delta_us / 1000000u,
+                record->delta_us % 1000000u);
+      }
+      if (record->prefix & DebugPrefix_Thread)
+        fprintf(out, "T%lu ", record->thread);
+
+      (void)fwrite(record->text, 1, record->len, out);
+      if (record->newline)
+        (void)fputc('\n', out);
+      break;
+
+    case Format_CSV:
+      if (query->time_seen)
+        fprintf(out, "%llu", query->last_time_us);
+      (void)fputc(',', out);
+      if (record->prefix & DebugPrefix_Thread)
+        fprintf(out, "%lu", record->thread);
+      (void)fputc(',', out);
+      write_category(out, record->category);
+      (void)fputc(',', out);
+      if (record->site != NULL)
+        write_csv_field(out, record->site, strlen(record->site));
+      (void)fputc(',', out);
+      write_csv_field(out, record->text, record->len);
+      (void)fputs("\r\n", out);
+      break;
+
+    case Format_Counts:
+      /* Preformatted text has no call site, so count identical lines */
+      add_count(query, record->category,
+                record->site != NULL ? record->site : record->text);
+      break;
+  }
+}
+
+/* ----------------------------------------------------------------------- */
+
+static bool parse_options(int *argi, int argc, char *argv[], Query *query)
+{
+  int i = 1;
+
+  for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; ++i)
+  {
+    const char *const option = argv[i];
+    if (strcmp(option, "--") == 0)
+    {
+      ++i;
+      break;
+    }
+
+    if (option[2] != '\0' || i + 1 >= argc)
+      return false;
+
+    const char *const value = argv[++i];
+    switch (option[1])
+    {
+      case 'c':
+        if (!parse_category(value, &query->category))
+          return false;
+        query->any_category = false;
+        break;
+
+      case 's':
+        query->site = value;
+        break;
+
+      case 'f':
+        if (!parse_time(value, &query->from_us))
+          return false;
+        query->any_time = false;
+        break;
+
+      case 't':
+        if (!parse_time(value, &query->to_us))
+          return false;
+        query->any_time = false;
+        break;
+
+      case 'o':
+      {
+        char *end;
+        query->id = strtoull(value, &end, 0);
+        if (*value == '\0' || *end != '\0')
+          return false;
+        query->any_id = false;
+        break;
+      }
+
+      case 'F':
+        if (strcmp(value, "text") == 0)
+          query->format = Format_Text;
+        else if (strcmp(value, "csv") == 0)
+          query->format = Format_CSV;
+        else if (strcmp(value, "counts") == 0)
+          query->format = Format_Counts;
+        else
+          return false;
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  *argi = i;
+  return argc - i <= 2;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  FILE *in = stdin, *out = stdout;
+  Query query =
+  {
+    .format = Format_Text,
+    .any_category = true,
+    .any_time = true,
+    .to_us = (unsigned long long)-1,
+    .any_id = true
+  };
+  int argi;
+
+  if (!parse_options(&argi, argc, argv, &query))
+  {
+    fprintf(stderr, "Usage: %s [-c category] [-s text] [-f seconds] "
+            "[-t seconds] [-o id] [-F text|csv|counts] [input [output]]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char *const in_path = argi < argc ? argv[argi] : NULL;
+  const char *const out_path = argi + 1 < argc ? argv[argi + 1] : NULL;
+
+  if (in_path != NULL)
+  {
+    in = fopen(in_path, "rb");
+    if (in == NULL)
+    {
+      perror(in_path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (out_path != NULL)
+  {
+    out = fopen(out_path, "w");
+    if (out == NULL)
+    {
+      perror(out_path);
+      fclose(in);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Large buffers reduce the number of system calls for big logs */
+  (void)setvbuf(in, NULL, _IOFBF, StreamBufferSize);
+  (void)setvbuf(out, NULL, _IOFBF, StreamBufferSize);
+
+  query.out = out;
+  if (query.format == Format_CSV)
+    (void)fputs("time_us,thread,category,site,text\r\n", out);
+
+  bool ok = debug_bin_read(in, query_record, &query);
+  if (!ok)
+  {
+    fprintf(stderr, "%s: malformed input\n", argv[0]);
+  }
+  else if (query.failed)
+  {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    ok = false;
+  }
+
+  if (query.format == Format_Counts)
+    write_counts(&query);
+
+  if (in != stdin)
+    fclose(in);
+
+  if (out != stdout ? fclose(out) != 0 : fflush(out) != 0)
+  {
+    perror(out_path != NULL ? out_path : "stdout");
+    return EXIT_FAILURE;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}